@@ -0,0 +1,203 @@
+//! Criterion suite for the hot paths: the parallel walk, per-file hashing
+//! across the size classes around MMAP_THRESHOLD/RAYON_THRESHOLD, and
+//! end-to-end `run_compare` in Batch and Metadata modes.
+//!
+//! Trees are materialised by a deterministic xorshift generator, so two
+//! runs of the suite (or two machines with the same criterion baseline)
+//! benchmark byte-identical inputs. Compare numbers with
+//! `cargo bench -- --save-baseline <name>` / `--baseline <name>`.
+
+use criterion::{Criterion, criterion_group, criterion_main};
+use std::fs;
+use std::hint::black_box;
+use std::path::{Path, PathBuf};
+
+use cmpf::compare::{CompareConfig, run_compare};
+use cmpf::models::{Engine, HashAlgo, Mode, OutputFormat, SymlinkMode};
+use cmpf::utils::{collect_files, compute_hashes};
+
+/// Minimal deterministic RNG (xorshift64*); no rand dependency needed.
+struct XorShift(u64);
+
+impl XorShift {
+    fn new(seed: u64) -> Self {
+        XorShift(seed.max(1))
+    }
+
+    fn next_u64(&mut self) -> u64 {
+        let mut x = self.0;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        self.0 = x;
+        x.wrapping_mul(0x2545F4914F6CDD1D)
+    }
+
+    fn fill(&mut self, buf: &mut [u8]) {
+        for chunk in buf.chunks_mut(8) {
+            let v = self.next_u64().to_le_bytes();
+            chunk.copy_from_slice(&v[..chunk.len()]);
+        }
+    }
+}
+
+/// Shape of a generated tree.
+struct TreeSpec {
+    files: usize,
+    /// Directory depth; files are spread round-robin across one chain of
+    /// nested directories per level.
+    depth: usize,
+    /// File sizes cycle through this list, so the tree mixes size classes
+    /// deterministically.
+    sizes: &'static [usize],
+}
+
+/// Materialise `spec` under `root` from `seed`. Same seed, same bytes.
+fn build_tree(root: &Path, spec: &TreeSpec, seed: u64) {
+    let mut rng = XorShift::new(seed);
+    for i in 0..spec.files {
+        let mut dir = root.to_path_buf();
+        for level in 0..(i % (spec.depth + 1)) {
+            dir = dir.join(format!("d{}", level));
+        }
+        fs::create_dir_all(&dir).unwrap();
+        let mut data = vec![0u8; spec.sizes[i % spec.sizes.len()]];
+        rng.fill(&mut data);
+        fs::write(dir.join(format!("f{:04}.bin", i)), &data).unwrap();
+    }
+}
+
+/// Rewrite roughly `ratio` of the files in `root`'s generation order with
+/// fresh bytes, producing a deterministic "changed" copy of the tree.
+fn mutate_tree(root: &Path, spec: &TreeSpec, seed: u64, ratio: f64) {
+    let mut rng = XorShift::new(seed);
+    let step = (1.0 / ratio.max(0.001)) as usize;
+    for i in (0..spec.files).step_by(step.max(1)) {
+        let mut dir = root.to_path_buf();
+        for level in 0..(i % (spec.depth + 1)) {
+            dir = dir.join(format!("d{}", level));
+        }
+        let mut data = vec![0u8; spec.sizes[i % spec.sizes.len()]];
+        rng.fill(&mut data);
+        fs::write(dir.join(format!("f{:04}.bin", i)), &data).unwrap();
+    }
+}
+
+fn compare_config(folder1: PathBuf, folder2: PathBuf, mode: Mode) -> CompareConfig {
+    CompareConfig {
+        folder1,
+        folder2,
+        mode,
+        algo: HashAlgo::Blake3,
+        output_folder: None,
+        output_format: OutputFormat::Txt,
+        depth: None,
+        no_recursive: false,
+        symlinks: SymlinkMode::Ignore,
+        verbose: false,
+        hidden: false,
+        types: None,
+        ignore: None,
+        threads: None,
+        no_sort: false,
+        diff_cmd: None,
+        cache: false,
+        cache_dir: None,
+        engine: Engine::Classic,
+        hash_sample: None,
+        fail_fast: false,
+        memory_limit: None,
+    }
+}
+
+fn bench_collect_files(c: &mut Criterion) {
+    let dir = tempfile::tempdir().unwrap();
+    let spec = TreeSpec {
+        files: 1000,
+        depth: 4,
+        sizes: &[0],
+    };
+    build_tree(dir.path(), &spec, 0xC0FFEE);
+
+    c.bench_function("collect_files/1000_files_depth_4", |b| {
+        b.iter(|| {
+            let (files, errors) = collect_files(
+                black_box(dir.path()),
+                None,
+                false,
+                false,
+                &None,
+                &None,
+                SymlinkMode::Ignore,
+            )
+            .unwrap();
+            assert_eq!(files.len(), 1000);
+            black_box((files, errors))
+        })
+    });
+}
+
+fn bench_compute_hashes(c: &mut Criterion) {
+    let dir = tempfile::tempdir().unwrap();
+    let mut rng = XorShift::new(0xBEEF);
+
+    // 4 KiB sits below MMAP_THRESHOLD (read path), 256 KiB and 8 MiB above
+    // it (mmap path). RAYON_THRESHOLD files are too large to iterate here.
+    let mut group = c.benchmark_group("compute_hashes");
+    for (label, size) in [("4KiB", 4 << 10), ("256KiB", 256 << 10), ("8MiB", 8 << 20)] {
+        let path = dir.path().join(format!("{}.bin", label));
+        let mut data = vec![0u8; size];
+        rng.fill(&mut data);
+        fs::write(&path, &data).unwrap();
+
+        group.throughput(criterion::Throughput::Bytes(size as u64));
+        for algo in [
+            HashAlgo::Blake3,
+            HashAlgo::Xxh3,
+            HashAlgo::Sha256,
+            HashAlgo::Sha256Tree,
+        ] {
+            group.bench_function(format!("{:?}/{}", algo, label), |b| {
+                b.iter(|| compute_hashes(black_box(&path), algo).unwrap())
+            });
+        }
+    }
+    group.finish();
+}
+
+fn bench_run_compare(c: &mut Criterion) {
+    let spec = TreeSpec {
+        files: 300,
+        depth: 3,
+        sizes: &[1 << 10, 16 << 10, 64 << 10],
+    };
+    let dir1 = tempfile::tempdir().unwrap();
+    let dir2 = tempfile::tempdir().unwrap();
+    build_tree(dir1.path(), &spec, 0xABCD);
+    build_tree(dir2.path(), &spec, 0xABCD);
+    mutate_tree(dir2.path(), &spec, 0x1234, 0.1);
+
+    let mut group = c.benchmark_group("run_compare");
+    group.sample_size(20);
+    for mode in [Mode::Batch, Mode::Metadata] {
+        group.bench_function(format!("{:?}/300_files_10pct_diff", mode), |b| {
+            b.iter(|| {
+                let config = compare_config(
+                    dir1.path().to_path_buf(),
+                    dir2.path().to_path_buf(),
+                    mode,
+                );
+                run_compare(black_box(config)).unwrap()
+            })
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_collect_files,
+    bench_compute_hashes,
+    bench_run_compare
+);
+criterion_main!(benches);
@@ -0,0 +1,399 @@
+//! Remote agent mode: compare a local tree against a folder on another
+//! host by exchanging digests instead of file contents.
+//!
+//! `cmpf agent <folder>` scans and hashes on its own machine and streams a
+//! compact NDJSON digest manifest to stdout — one `{"file", "size",
+//! "digest"}` object per file, error records, and a trailing summary. The
+//! local side spawns that agent over SSH, hashes its own tree in the
+//! meantime, and joins the incoming manifest against the local scan. Only
+//! the manifest crosses the network: megabytes instead of the terabytes an
+//! NFS/SSHFS mount would pull across just to hash remotely-stored bytes.
+
+use anyhow::{Context, Result, bail};
+use colored::*;
+use rayon::prelude::*;
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::io::{self, BufRead, BufReader, IsTerminal, Write};
+use std::path::PathBuf;
+use std::process::{Command, Stdio};
+use std::time::Instant;
+
+use crate::compare::ExitStatus;
+use crate::models::{ErrorEntry, HashAlgo, OutputFormat, Status, SymlinkMode};
+use crate::report::{open_report_sink, print_error_entry, report_filename};
+use crate::utils::{collect_files, compute_hashes};
+
+/// One line of the agent's manifest stream.
+#[derive(Serialize, Deserialize)]
+struct ManifestEntry {
+    file: PathBuf,
+    size: u64,
+    digest: Option<String>,
+}
+
+pub struct AgentConfig {
+    pub folder: PathBuf,
+    pub algo: HashAlgo,
+    pub depth: Option<usize>,
+    pub no_recursive: bool,
+    pub hidden: bool,
+    pub types: Option<Vec<String>>,
+    pub ignore: Option<Vec<String>>,
+    pub symlinks: SymlinkMode,
+    pub threads: Option<usize>,
+}
+
+pub struct RemoteCompareConfig {
+    pub folder1: PathBuf,
+    /// `[user@]host` part of the remote spec.
+    pub host: String,
+    /// Folder path on the remote machine.
+    pub remote_path: String,
+    /// Command the agent is launched with on the remote side.
+    pub remote_cmd: String,
+    pub algo: HashAlgo,
+    pub output_folder: Option<PathBuf>,
+    pub output_format: OutputFormat,
+    pub depth: Option<usize>,
+    pub no_recursive: bool,
+    pub hidden: bool,
+    pub types: Option<Vec<String>>,
+    pub ignore: Option<Vec<String>>,
+    pub symlinks: SymlinkMode,
+    pub threads: Option<usize>,
+}
+
+/// Split `[user@]host:path` the way rsync does: the text before the first
+/// `:` is a host only if it contains no path separator. Returns None for
+/// plain local paths, including relative ones with colons after a slash.
+pub fn parse_remote_spec(spec: &str) -> Option<(String, String)> {
+    let (host, path) = spec.split_once(':')?;
+    if host.is_empty() || host.contains('/') || host.contains('\\') {
+        return None;
+    }
+    Some((host.to_string(), path.to_string()))
+}
+
+/// Scan + hash the local folder and stream the manifest to `sink`.
+/// Returns the number of walk/hash errors encountered.
+fn write_manifest(sink: &mut dyn Write, config: &AgentConfig) -> Result<usize> {
+    let (files, errors) = collect_files(
+        &config.folder,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+    )?;
+    for e in &errors {
+        serde_json::to_writer(&mut *sink, &serde_json::json!({"error": e, "source": "agent"}))?;
+        writeln!(sink)?;
+    }
+
+    // A file that can't be hashed must not abort the whole manifest: the
+    // local side tolerates our Error exit on the assumption that failures
+    // were reported in-band, so report them in-band like walk errors and
+    // keep going.
+    let hashed: Vec<std::result::Result<ManifestEntry, ErrorEntry>> = files
+        .par_iter()
+        .map(|f| match compute_hashes(&f.path, config.algo) {
+            Ok(h) => Ok(ManifestEntry {
+                file: f.path.strip_prefix(&config.folder).unwrap().to_path_buf(),
+                size: f.size,
+                digest: h.primary_digest(config.algo).map(str::to_string),
+            }),
+            Err(e) => Err(ErrorEntry {
+                path: f.path.clone(),
+                error: e.to_string(),
+            }),
+        })
+        .collect();
+
+    let mut entry_count = 0;
+    let mut hash_errors = 0;
+    for item in &hashed {
+        match item {
+            Ok(e) => {
+                serde_json::to_writer(&mut *sink, e)?;
+                entry_count += 1;
+            }
+            Err(e) => {
+                serde_json::to_writer(
+                    &mut *sink,
+                    &serde_json::json!({"error": e, "source": "agent"}),
+                )?;
+                hash_errors += 1;
+            }
+        }
+        writeln!(sink)?;
+    }
+    serde_json::to_writer(
+        &mut *sink,
+        &serde_json::json!({"summary": {"files": entry_count, "errors": errors.len() + hash_errors}}),
+    )?;
+    writeln!(sink)?;
+    sink.flush()?;
+    Ok(errors.len() + hash_errors)
+}
+
+/// `cmpf agent`: the remote end of a digest exchange. Everything goes to
+/// stdout so the caller can pipe it straight over SSH.
+pub fn run_agent(config: AgentConfig) -> Result<ExitStatus> {
+    // Fix #5: silently ignore if global pool is already initialised
+    if let Some(num_threads) = config.threads {
+        let _ = rayon::ThreadPoolBuilder::new()
+            .num_threads(num_threads)
+            .build_global();
+    }
+
+    let stdout = io::stdout();
+    let mut sink = io::BufWriter::new(stdout.lock());
+    let errors = write_manifest(&mut sink, &config)?;
+    if errors > 0 {
+        Ok(ExitStatus::Error)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
+
+/// Join a streamed manifest against the local `(size, digest)` map.
+/// Consumes the local map; what remains afterwards is missing remotely.
+fn join_manifest(
+    local: &mut HashMap<PathBuf, (u64, Option<String>)>,
+    reader: impl BufRead,
+) -> Result<(Vec<(PathBuf, Status)>, usize)> {
+    let mut results = Vec::new();
+    let mut remote_errors = 0;
+    for line in reader.lines() {
+        let line = line?;
+        if line.trim().is_empty() {
+            continue;
+        }
+        let value: serde_json::Value =
+            serde_json::from_str(&line).context("malformed manifest line from agent")?;
+        if value.get("error").is_some() {
+            remote_errors += 1;
+            eprintln!("{} {}", "[AGENT ERROR]".red().bold(), value);
+            continue;
+        }
+        if value.get("summary").is_some() {
+            continue;
+        }
+        let entry: ManifestEntry = serde_json::from_value(value)?;
+        match local.remove(&entry.file) {
+            None => results.push((entry.file, Status::Extra)),
+            Some((size, digest)) => {
+                let status = if size == entry.size && digest == entry.digest {
+                    Status::Match
+                } else {
+                    Status::Diff
+                };
+                results.push((entry.file, status));
+            }
+        }
+    }
+    // Whatever the agent never mentioned exists only locally.
+    for (file, _) in local.drain() {
+        results.push((file, Status::Missing));
+    }
+    Ok((results, remote_errors))
+}
+
+/// Local side of `cmpf compare <local> host:path`: spawn the agent over
+/// SSH, hash the local tree while the manifest streams in, then join.
+pub fn run_remote_compare(config: RemoteCompareConfig) -> Result<ExitStatus> {
+    let start_time = Instant::now();
+
+    // Fix #5: silently ignore if global pool is already initialised
+    if let Some(num_threads) = config.threads {
+        let _ = rayon::ThreadPoolBuilder::new()
+            .num_threads(num_threads)
+            .build_global();
+    }
+
+    if io::stdout().is_terminal() {
+        println!(
+            "{} {} against {}:{}",
+            "Remote Comparison".bright_cyan(),
+            config.folder1.display(),
+            config.host,
+            config.remote_path
+        );
+    }
+
+    // The remote command is passed through the user's login shell, so the
+    // path gets single-quoted; filter flags are forwarded so both sides
+    // walk with identical semantics.
+    let algo = format!("{:?}", config.algo).to_lowercase();
+    let mut remote = format!(
+        "{} agent '{}' --algo {}",
+        config.remote_cmd,
+        config.remote_path.replace('\'', "'\\''"),
+        algo
+    );
+    if let Some(depth) = config.depth {
+        remote.push_str(&format!(" --depth {}", depth));
+    }
+    if config.no_recursive {
+        remote.push_str(" --no-recursive");
+    }
+    if config.hidden {
+        remote.push_str(" --hidden");
+    }
+    if let Some(ref types) = config.types {
+        for t in types {
+            remote.push_str(&format!(" --type '{}'", t.replace('\'', "'\\''")));
+        }
+    }
+    if let Some(ref ignore) = config.ignore {
+        for pat in ignore {
+            remote.push_str(&format!(" --ignore '{}'", pat.replace('\'', "'\\''")));
+        }
+    }
+
+    let mut child = Command::new("ssh")
+        .arg(&config.host)
+        .arg(&remote)
+        .stdin(Stdio::null())
+        .stdout(Stdio::piped())
+        .spawn()
+        .context("failed to spawn ssh; is it on PATH?")?;
+    let agent_out = BufReader::new(child.stdout.take().expect("piped stdout"));
+
+    // Hash locally while the agent does the same on its machine.
+    let (files, errors) = collect_files(
+        &config.folder1,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+    )?;
+    for e in &errors {
+        print_error_entry(e, "folder1");
+    }
+    let mut local: HashMap<PathBuf, (u64, Option<String>)> = files
+        .par_iter()
+        .map(|f| -> Result<(PathBuf, (u64, Option<String>))> {
+            let h = compute_hashes(&f.path, config.algo)?;
+            Ok((
+                f.path.strip_prefix(&config.folder1).unwrap().to_path_buf(),
+                (f.size, h.primary_digest(config.algo).map(str::to_string)),
+            ))
+        })
+        .collect::<Result<HashMap<_, _>>>()?;
+
+    let (mut results, remote_errors) = join_manifest(&mut local, agent_out)?;
+    let agent_status = child.wait()?;
+    if !agent_status.success() && agent_status.code() != Some(ExitStatus::Error as i32) {
+        bail!("remote agent failed with {}", agent_status);
+    }
+    results.sort_by(|a, b| a.0.cmp(&b.0));
+
+    let matches = results.iter().filter(|(_, s)| *s == Status::Match).count();
+    let diffs = results.iter().filter(|(_, s)| *s == Status::Diff).count();
+    let missing = results
+        .iter()
+        .filter(|(_, s)| *s == Status::Missing)
+        .count();
+    let extra = results.iter().filter(|(_, s)| *s == Status::Extra).count();
+    let total_errors = errors.len() + remote_errors;
+
+    let (mut sink, report_path) = open_report_sink(
+        &config.output_folder,
+        report_filename(config.output_format),
+    )?;
+    match config.output_format {
+        OutputFormat::Txt => {
+            for (file, status) in &results {
+                if *status == Status::Match {
+                    continue;
+                }
+                writeln!(
+                    sink,
+                    "[{}]  {}",
+                    status.to_string().red().bold(),
+                    file.display()
+                )?;
+            }
+            writeln!(sink)?;
+            writeln!(
+                sink,
+                "{} files: {} match, {} diff, {} missing, {} extra ({:.2?})",
+                results.len(),
+                matches,
+                diffs,
+                missing,
+                extra,
+                start_time.elapsed()
+            )?;
+        }
+        OutputFormat::Json => {
+            let doc = serde_json::json!({
+                "summary": {
+                    "remote": format!("{}:{}", config.host, config.remote_path),
+                    "total": results.len(),
+                    "matches": matches,
+                    "diffs": diffs,
+                    "missing": missing,
+                    "extra": extra,
+                    "errors": total_errors,
+                    "time_taken": format!("{:.2?}", start_time.elapsed()),
+                },
+                "results": results.iter().map(|(file, status)| {
+                    serde_json::json!({"file": file, "status": status})
+                }).collect::<Vec<_>>(),
+            });
+            serde_json::to_writer(&mut *sink, &doc)?;
+            writeln!(sink)?;
+        }
+        OutputFormat::Ndjson => {
+            for (file, status) in &results {
+                serde_json::to_writer(
+                    &mut *sink,
+                    &serde_json::json!({"file": file, "status": status}),
+                )?;
+                writeln!(sink)?;
+            }
+            serde_json::to_writer(
+                &mut *sink,
+                &serde_json::json!({"summary": {
+                    "total": results.len(),
+                    "matches": matches,
+                    "diffs": diffs,
+                    "missing": missing,
+                    "extra": extra,
+                    "errors": total_errors,
+                }}),
+            )?;
+            writeln!(sink)?;
+        }
+    }
+    crate::report::finish_report_sink(sink, report_path)?;
+
+    if total_errors > 0 {
+        Ok(ExitStatus::Error)
+    } else if diffs + missing + extra > 0 {
+        Ok(ExitStatus::Diff)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
+
+#[cfg(test)]
+pub(crate) fn manifest_for_tests(config: &AgentConfig) -> Result<Vec<u8>> {
+    let mut buf = Vec::new();
+    write_manifest(&mut buf, config)?;
+    Ok(buf)
+}
+
+#[cfg(test)]
+pub(crate) fn join_manifest_for_tests(
+    local: &mut HashMap<PathBuf, (u64, Option<String>)>,
+    manifest: &[u8],
+) -> Result<(Vec<(PathBuf, Status)>, usize)> {
+    join_manifest(local, BufReader::new(manifest))
+}
@@ -0,0 +1,207 @@
+use anyhow::Result;
+use serde::{Deserialize, Serialize};
+use std::collections::HashMap;
+use std::fs::{self, File};
+use std::io::{self, BufReader, BufWriter};
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::time::{SystemTime, UNIX_EPOCH};
+
+use crate::models::{HashAlgo, HashResult};
+use crate::utils::compute_hashes;
+
+/// Bump this when the on-disk layout changes; a version mismatch simply
+/// discards the old cache instead of trying to migrate it.
+const CACHE_VERSION: u32 = 1;
+
+/// Entries that have not been hit for this long are pruned on save, so the
+/// cache does not grow without bound as files are renamed or deleted.
+const MAX_IDLE_SECS: u64 = 60 * 60 * 24 * 30; // 30 days
+
+#[derive(Serialize, Deserialize, Clone)]
+struct CacheEntry {
+    size: u64,
+    mtime_secs: u64,
+    mtime_nanos: u32,
+    last_used: u64,
+    hashes: HashResult,
+}
+
+#[derive(Serialize, Deserialize)]
+struct CacheFile {
+    version: u32,
+    entries: HashMap<String, CacheEntry>,
+}
+
+/// Persistent hash cache keyed by (absolute path, size, mtime).
+///
+/// A lookup only counts as a hit when the stored size and mtime match the
+/// current metadata exactly *and* the stored digests cover the requested
+/// algorithm; anything else falls through to `compute_hashes` and the entry
+/// is replaced. Safe to share across rayon workers.
+pub struct HashCache {
+    path: PathBuf,
+    entries: Mutex<HashMap<String, CacheEntry>>,
+    dirty: AtomicBool,
+}
+
+impl HashCache {
+    /// Open (or initialise) the cache, honouring `$XDG_CACHE_HOME` and
+    /// falling back to `~/.cache/cmpf/` unless an explicit dir is given.
+    pub fn open(dir_override: Option<&Path>) -> Result<Self> {
+        let dir = match dir_override {
+            Some(d) => d.to_path_buf(),
+            None => default_cache_dir()?,
+        };
+        fs::create_dir_all(&dir)?;
+        let path = dir.join("hash_cache.json");
+
+        let entries = match File::open(&path) {
+            Ok(f) => match serde_json::from_reader::<_, CacheFile>(BufReader::new(f)) {
+                Ok(cf) if cf.version == CACHE_VERSION => cf.entries,
+                // Unreadable or incompatible cache: start fresh rather than error out.
+                _ => HashMap::new(),
+            },
+            Err(_) => HashMap::new(),
+        };
+
+        Ok(HashCache {
+            path,
+            entries: Mutex::new(entries),
+            dirty: AtomicBool::new(false),
+        })
+    }
+
+    /// Return cached digests for `path` if size and mtime still match and the
+    /// stored digests cover the requested algorithm. Never touches the file.
+    pub fn peek(
+        &self,
+        path: &Path,
+        size: u64,
+        modified: Option<SystemTime>,
+        algo: HashAlgo,
+    ) -> Option<HashResult> {
+        // Without a trustworthy mtime we cannot validate an entry.
+        let (mtime_secs, mtime_nanos) = modified
+            .and_then(|m| m.duration_since(UNIX_EPOCH).ok())
+            .map(|d| (d.as_secs(), d.subsec_nanos()))?;
+
+        let key = path.to_string_lossy();
+
+        let mut map = self.entries.lock().unwrap();
+        if let Some(entry) = map.get_mut(key.as_ref())
+            && entry.size == size
+            && entry.mtime_secs == mtime_secs
+            && entry.mtime_nanos == mtime_nanos
+            && covers(&entry.hashes, algo)
+        {
+            entry.last_used = now_secs();
+            self.dirty.store(true, Ordering::Relaxed);
+            return Some(entry.hashes.clone());
+        }
+        None
+    }
+
+    /// Return cached digests for `path` if size and mtime still match,
+    /// otherwise hash the file and store the fresh result.
+    pub fn get_or_compute(
+        &self,
+        path: &Path,
+        size: u64,
+        modified: Option<SystemTime>,
+        algo: HashAlgo,
+    ) -> io::Result<HashResult> {
+        // Tree digests are never cached: they would overwrite the sha256
+        // slot and poison it for later plain-sha256 lookups.
+        if algo == HashAlgo::Sha256Tree {
+            return compute_hashes(path, algo);
+        }
+
+        if let Some(hashes) = self.peek(path, size, modified, algo) {
+            return Ok(hashes);
+        }
+
+        let (mtime_secs, mtime_nanos) = match modified.and_then(|m| m.duration_since(UNIX_EPOCH).ok())
+        {
+            Some(d) => (d.as_secs(), d.subsec_nanos()),
+            // No validatable mtime: hash without storing.
+            None => return compute_hashes(path, algo),
+        };
+
+        let key = path.to_string_lossy().to_string();
+
+        let hashes = compute_hashes(path, algo)?;
+
+        let mut map = self.entries.lock().unwrap();
+        map.insert(
+            key,
+            CacheEntry {
+                size,
+                mtime_secs,
+                mtime_nanos,
+                last_used: now_secs(),
+                hashes: hashes.clone(),
+            },
+        );
+        self.dirty.store(true, Ordering::Relaxed);
+
+        Ok(hashes)
+    }
+
+    /// Persist the cache, dropping entries that have been idle for longer
+    /// than the retention window. Writes to a temp file and renames so a
+    /// crash mid-save never leaves a truncated cache behind.
+    pub fn save(&self) -> Result<()> {
+        if !self.dirty.load(Ordering::Relaxed) {
+            return Ok(());
+        }
+
+        let mut entries = self.entries.lock().unwrap().clone();
+        let cutoff = now_secs().saturating_sub(MAX_IDLE_SECS);
+        entries.retain(|_, e| e.last_used >= cutoff);
+
+        let tmp_path = self.path.with_extension("json.tmp");
+        let f = File::create(&tmp_path)?;
+        serde_json::to_writer(
+            BufWriter::new(f),
+            &CacheFile {
+                version: CACHE_VERSION,
+                entries,
+            },
+        )?;
+        fs::rename(&tmp_path, &self.path)?;
+        Ok(())
+    }
+}
+
+/// True if the stored digests are sufficient for the requested algorithm.
+fn covers(h: &HashResult, algo: HashAlgo) -> bool {
+    match algo {
+        HashAlgo::Sha256 => h.sha256.is_some(),
+        HashAlgo::Blake3 => h.blake3.is_some(),
+        HashAlgo::Both => h.sha256.is_some() && h.blake3.is_some(),
+        HashAlgo::Xxh3 => h.xxh3.is_some(),
+        // Tree digests share the sha256 slot with plain digests, so a
+        // stored entry can never be proven to be the right flavour.
+        HashAlgo::Sha256Tree => false,
+    }
+}
+
+fn default_cache_dir() -> Result<PathBuf> {
+    if let Ok(xdg) = std::env::var("XDG_CACHE_HOME")
+        && !xdg.is_empty()
+    {
+        return Ok(PathBuf::from(xdg).join("cmpf"));
+    }
+    let home = std::env::var("HOME")
+        .map_err(|_| anyhow::anyhow!("Cannot determine cache directory: $HOME is not set"))?;
+    Ok(PathBuf::from(home).join(".cache").join("cmpf"))
+}
+
+fn now_secs() -> u64 {
+    SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .map(|d| d.as_secs())
+        .unwrap_or(0)
+}
@@ -3,19 +3,28 @@ use chrono::{DateTime, Local};
 use colored::*;
 use indicatif::{ProgressBar, ProgressStyle};
 use rayon::prelude::*;
-use std::collections::{HashMap, HashSet};
-use std::io::{self, IsTerminal};
-use std::path::PathBuf;
+use std::collections::HashMap;
+use std::io::{self, IsTerminal, Write};
+use std::path::{Path, PathBuf};
+use std::sync::Mutex;
 use std::time::Instant;
 
+use crate::cache::HashCache;
+use crate::extsort::ExternalSorter;
 use crate::models::{
-    ComparisonResult, FileEntry, HashAlgo, Mode, OutputFormat, Status, SymlinkMode,
+    ComparisonResult, DirIndex, Engine, ErrorEntry, FileEntry, HashAlgo, HashResult, Mode,
+    OutputFormat, PathArena, PathId, Status, SymlinkMode,
 };
 use crate::report::{
-    ReportConfig, SummaryData, generate_json_report, generate_summary_text, generate_text_report,
-    print_error_entry, print_realtime_missing, write_report,
+    ReportConfig, SummaryData, finish_report_sink, generate_summary_text, open_report_sink,
+    print_error_entry, print_realtime_missing, report_filename, write_json_report,
+    write_ndjson_error, write_ndjson_report, write_ndjson_result, write_ndjson_summary,
+    write_text_report,
+};
+use crate::utils::{
+    BatchedProgress, WALK_CHANNEL_CAP, collect_files, compare_bytes, compute_hashes,
+    compute_hashes_sampled, stream_files, walk_sorted,
 };
-use crate::utils::{collect_files, compute_hashes};
 
 #[derive(Debug, PartialEq)]
 pub enum ExitStatus {
@@ -41,6 +50,14 @@ pub struct CompareConfig {
     pub threads: Option<usize>,
     pub no_sort: bool,
     pub diff_cmd: Option<String>,
+    pub cache: bool,
+    pub cache_dir: Option<PathBuf>,
+    pub engine: Engine,
+    pub hash_sample: Option<usize>,
+    pub fail_fast: bool,
+    /// Spill results to sorted disk runs past this many bytes of buffered
+    /// results (classic batch engine); None keeps everything in memory.
+    pub memory_limit: Option<u64>,
 }
 
 pub fn run_compare(config: CompareConfig) -> Result<ExitStatus> {
@@ -54,10 +71,76 @@ pub fn run_compare(config: CompareConfig) -> Result<ExitStatus> {
             .build_global();
     }
 
-    match config.mode {
-        Mode::Realtime => run_realtime(&config, start_time),
-        Mode::Batch | Mode::Metadata => run_batch(&config, start_time),
+    // The cache is opened once per run and saved once at the end; individual
+    // lookups happen inside the hashing closures in compare_files_core.
+    let cache = if config.cache {
+        Some(HashCache::open(config.cache_dir.as_deref())?)
+    } else {
+        None
+    };
+
+    let status = match config.mode {
+        Mode::Realtime => run_realtime(&config, cache.as_ref(), start_time),
+        Mode::Batch | Mode::Metadata | Mode::Bytes => match config.engine {
+            Engine::Classic => run_batch(&config, cache.as_ref(), start_time),
+            Engine::Streaming => run_batch_streaming(&config, cache.as_ref(), start_time),
+            Engine::Merge => run_merge(&config, cache.as_ref(), start_time),
+        },
+    }?;
+
+    if let Some(c) = &cache {
+        c.save()?;
+    }
+
+    Ok(status)
+}
+
+/// Per-run digest memo keyed by (device, inode). In hardlink-heavy trees
+/// (rsync --link-dest backups) many paths alias the same bytes; the memo
+/// guarantees each inode is hashed at most once per run. Two threads can
+/// race past a miss and hash the same inode twice — that is harmless and
+/// cheaper than holding the lock across the hash.
+pub(crate) struct InodeMemo(Mutex<HashMap<(u64, u64), HashResult>>);
+
+impl InodeMemo {
+    pub(crate) fn new() -> Self {
+        InodeMemo(Mutex::new(HashMap::new()))
+    }
+
+    fn get(&self, id: (u64, u64)) -> Option<HashResult> {
+        self.0.lock().unwrap().get(&id).cloned()
+    }
+
+    fn insert(&self, id: (u64, u64), h: HashResult) {
+        self.0.lock().unwrap().insert(id, h);
+    }
+}
+
+/// Hash a file, going through the inode memo and the persistent cache
+/// when they are enabled.
+fn hash_entry(
+    entry: &FileEntry,
+    config: &CompareConfig,
+    cache: Option<&HashCache>,
+    memo: Option<&InodeMemo>,
+) -> io::Result<HashResult> {
+    let algo = config.algo;
+    if let (Some(memo), Some(id)) = (memo, entry.file_id)
+        && let Some(h) = memo.get(id)
+    {
+        return Ok(h);
+    }
+    let h = match (config.hash_sample, cache) {
+        // Sampled digests deliberately bypass the persistent cache: a cached
+        // full digest must never satisfy a sampled request or vice versa.
+        (Some(k), _) => compute_hashes_sampled(&entry.path, algo, k)?,
+        (None, Some(c)) => c.get_or_compute(&entry.path, entry.size, entry.modified, algo)?,
+        (None, None) => compute_hashes(&entry.path, algo)?,
+    };
+    if let (Some(memo), Some(id)) = (memo, entry.file_id) {
+        memo.insert(id, h.clone());
     }
+    Ok(h)
 }
 
 pub(crate) fn compare_files_core(
@@ -65,6 +148,8 @@ pub(crate) fn compare_files_core(
     entry1: &FileEntry,
     entry2: &FileEntry,
     config: &CompareConfig,
+    cache: Option<&HashCache>,
+    memo: Option<&InodeMemo>,
 ) -> Result<ComparisonResult> {
     let size1 = Some(entry1.size);
     let size2 = Some(entry2.size);
@@ -121,6 +206,24 @@ pub(crate) fn compare_files_core(
         }
     }
 
+    // Hardlink fast path: the same (device, inode) on both sides means both
+    // paths alias the same bytes on disk, so they match by construction —
+    // no need to even open the file.
+    if entry1.file_id.is_some() && entry1.file_id == entry2.file_id {
+        return Ok(ComparisonResult {
+            file: rel_path,
+            status: Status::Match,
+            hash1: None,
+            hash2: None,
+            size1,
+            size2,
+            modified1: time1_str,
+            modified2: time2_str,
+            symlink1: None,
+            symlink2: None,
+        });
+    }
+
     if entry1.size != entry2.size {
         return Ok(ComparisonResult {
             file: rel_path,
@@ -134,6 +237,26 @@ pub(crate) fn compare_files_core(
             symlink1: None,
             symlink2: None,
         });
+    } else if config.mode == Mode::Bytes {
+        // Same size: compare content directly, stopping at the first
+        // differing block. No digests are produced in this mode.
+        let status = match compare_bytes(&entry1.path, &entry2.path) {
+            Ok(true) => Status::Match,
+            Ok(false) => Status::Diff,
+            Err(_) => Status::Error,
+        };
+        return Ok(ComparisonResult {
+            file: rel_path,
+            status,
+            hash1: None,
+            hash2: None,
+            size1,
+            size2,
+            modified1: time1_str,
+            modified2: time2_str,
+            symlink1: None,
+            symlink2: None,
+        });
     } else if config.mode == Mode::Metadata {
         let status = if entry1.modified != entry2.modified {
             Status::Diff
@@ -155,16 +278,17 @@ pub(crate) fn compare_files_core(
     }
 
     let (h1_res, h2_res) = rayon::join(
-        || compute_hashes(&entry1.path, config.algo),
-        || compute_hashes(&entry2.path, config.algo),
+        || hash_entry(entry1, config, cache, memo),
+        || hash_entry(entry2, config, cache, memo),
     );
 
     let (status, h1, h2) = match (h1_res, h2_res) {
         (Ok(h1), Ok(h2)) => {
             let is_match = match config.algo {
-                HashAlgo::Sha256 => h1.sha256 == h2.sha256,
+                HashAlgo::Sha256 | HashAlgo::Sha256Tree => h1.sha256 == h2.sha256,
                 HashAlgo::Blake3 => h1.blake3 == h2.blake3,
                 HashAlgo::Both => h1.sha256 == h2.sha256 && h1.blake3 == h2.blake3,
+                HashAlgo::Xxh3 => h1.xxh3 == h2.xxh3,
             };
             (
                 if is_match {
@@ -193,7 +317,11 @@ pub(crate) fn compare_files_core(
     })
 }
 
-fn run_realtime(config: &CompareConfig, start_time: Instant) -> Result<ExitStatus> {
+fn run_realtime(
+    config: &CompareConfig,
+    cache: Option<&HashCache>,
+    start_time: Instant,
+) -> Result<ExitStatus> {
     if io::stdout().is_terminal() {
         println!(
             "{}",
@@ -250,11 +378,44 @@ fn run_realtime(config: &CompareConfig, start_time: Instant) -> Result<ExitStatu
     let mut diffs = 0;
     let mut missing = 0;
 
-    for entry1 in &files1 {
-        let rel_path = entry1.path.strip_prefix(&config.folder1)?.to_path_buf();
+    // Hash a bounded window of files ahead on all cores, then print the
+    // window's results in their original order. Output (and --diff-cmd
+    // launching) stays strictly sequential, so the live log reads exactly
+    // as it did when the loop was single-threaded, but hashing throughput
+    // matches Batch mode.
+    let lookahead = (rayon::current_num_threads() * 4).max(1);
+
+    for chunk in files1.chunks(lookahead) {
+        // Pairing mutates files2_map, so it happens serially before the
+        // parallel hashing stage.
+        let jobs: Vec<(PathBuf, &FileEntry, Option<FileEntry>)> = chunk
+            .iter()
+            .map(|entry1| {
+                let rel_path = entry1.path.strip_prefix(&config.folder1)?.to_path_buf();
+                let entry2 = files2_map.remove(&rel_path);
+                Ok((rel_path, entry1, entry2))
+            })
+            .collect::<Result<Vec<_>>>()?;
 
-        if let Some(entry2) = files2_map.remove(&rel_path) {
-            let result = compare_files_core(rel_path.clone(), entry1, &entry2, config)?;
+        let results: Vec<(PathBuf, Option<Result<ComparisonResult>>)> = jobs
+            .into_par_iter()
+            .map(|(rel_path, entry1, entry2)| match entry2 {
+                Some(entry2) => {
+                    let result =
+                        compare_files_core(rel_path.clone(), entry1, &entry2, config, cache, None);
+                    (rel_path, Some(result))
+                }
+                None => (rel_path, None),
+            })
+            .collect();
+
+        for (rel_path, result) in results {
+            let Some(result) = result else {
+                missing += 1;
+                print_realtime_missing(Status::Missing, &rel_path, config.verbose)?;
+                continue;
+            };
+            let result = result?;
 
             match result.status {
                 Status::Match => matches += 1,
@@ -262,7 +423,9 @@ fn run_realtime(config: &CompareConfig, start_time: Instant) -> Result<ExitStatu
                 _ => (),
             }
 
-            print!("{}", result.format_text(config.verbose, config.algo)?);
+            if !crate::report::quiet() {
+                print!("{}", result.format_text(config.verbose, config.algo)?);
+            }
 
             // Fix #11: use shlex-style splitting to support paths-with-spaces in diff_cmd
             if let Some(diff_cmd_str) = &config.diff_cmd
@@ -287,9 +450,6 @@ fn run_realtime(config: &CompareConfig, start_time: Instant) -> Result<ExitStatu
                         .spawn();
                 }
             }
-        } else {
-            missing += 1;
-            print_realtime_missing(Status::Missing, &rel_path, config.verbose)?;
         }
     }
 
@@ -338,7 +498,20 @@ fn run_realtime(config: &CompareConfig, start_time: Instant) -> Result<ExitStatu
     }
 }
 
-fn run_batch(config: &CompareConfig, start_time: Instant) -> Result<ExitStatus> {
+fn run_batch(
+    config: &CompareConfig,
+    cache: Option<&HashCache>,
+    start_time: Instant,
+) -> Result<ExitStatus> {
+    // Reject the combination before the (potentially hours-long) hash pass,
+    // not after it: the spilled report is a single streaming pass, and only
+    // txt and ndjson put the summary last.
+    if config.memory_limit.is_some() && config.output_format == OutputFormat::Json {
+        anyhow::bail!(
+            "--memory-limit cannot build a single JSON document; use --output-format ndjson (or txt)"
+        );
+    }
+
     if io::stdout().is_terminal() {
         println!(
             "{}",
@@ -380,42 +553,174 @@ fn run_batch(config: &CompareConfig, start_time: Instant) -> Result<ExitStatus>
     let (files1, errors1) = res1?;
     let (files2, errors2) = res2?;
 
-    let total_errors = errors1.len() + errors2.len();
+    let map_timer = crate::stats::enabled().then(Instant::now);
 
-    // Fix #4: build maps without double-cloning all keys
-    let files1_map: HashMap<PathBuf, FileEntry> = files1
-        .into_par_iter()
+    // Intern every rel path once into a shared arena; the maps, the
+    // intersection and the difference sets below all work on 4-byte ids
+    // instead of cloned PathBufs.
+    let mut arena = PathArena::new();
+    let files1_map: HashMap<PathId, FileEntry> = files1
+        .into_iter()
         .map(|f| {
             (
-                f.path.strip_prefix(&config.folder1).unwrap().to_path_buf(),
+                arena.intern(f.path.strip_prefix(&config.folder1).unwrap()),
                 f,
             )
         })
         .collect();
-    let files2_map: HashMap<PathBuf, FileEntry> = files2
-        .into_par_iter()
+    let files2_map: HashMap<PathId, FileEntry> = files2
+        .into_iter()
         .map(|f| {
             (
-                f.path.strip_prefix(&config.folder2).unwrap().to_path_buf(),
+                arena.intern(f.path.strip_prefix(&config.folder2).unwrap()),
                 f,
             )
         })
         .collect();
+    let arena = arena; // frozen: lookups only from here on
 
-    // Fix #4: use reference sets to avoid cloning every key twice
-    let set1_paths: HashSet<&PathBuf> = files1_map.keys().collect();
-    let set2_paths: HashSet<&PathBuf> = files2_map.keys().collect();
-
-    let common_paths: Vec<PathBuf> = set1_paths
-        .intersection(&set2_paths)
-        .map(|p| (*p).clone())
+    let mut common_paths: Vec<PathId> = files1_map
+        .keys()
+        .filter(|id| files2_map.contains_key(id))
+        .copied()
         .collect();
 
-    let pb = if io::stderr().is_terminal() {
-        let pb = ProgressBar::new(common_paths.len() as u64);
+    // Largest-first scheduling: in HashMap iteration order a handful of
+    // huge files can land at the tail of the run and leave one worker
+    // grinding alone after every other core has drained the queue. Sizes
+    // are already known from the walk, so order the work by the bigger of
+    // the two sides; the very largest files additionally parallelise
+    // internally once they cross the par-hash threshold.
+    common_paths.sort_unstable_by_key(|id| {
+        let s1 = files1_map.get(id).map_or(0, |e| e.size);
+        let s2 = files2_map.get(id).map_or(0, |e| e.size);
+        std::cmp::Reverse(s1.max(s2))
+    });
+
+    if let Some(t) = map_timer {
+        crate::stats::record_map_build(t.elapsed());
+    }
+
+    // Merkle-style subtree pruning: with the persistent cache active, roll up
+    // per-directory digests from cached entries on both sides. Directories
+    // whose rollups agree contain identical subtrees, so every common file
+    // under them is declared Match without re-checking it. Only directories
+    // where *every* file has a valid cache hit get a rollup, so a single
+    // changed or uncached file disables pruning for its whole ancestor chain.
+    let mut pruned_dirs: Vec<PathBuf> = Vec::new();
+    let mut cached1: HashMap<PathId, HashResult> = HashMap::new();
+    let mut cached2: HashMap<PathId, HashResult> = HashMap::new();
+    if let Some(c) = cache
+        && config.mode == Mode::Batch
+    {
+        let peek_side = |map: &HashMap<PathId, FileEntry>,
+                         peeked: &mut HashMap<PathId, HashResult>| {
+            let items: Vec<(PathBuf, Option<String>)> = map
+                .iter()
+                .map(|(&rel, entry)| {
+                    let hashes = c.peek(&entry.path, entry.size, entry.modified, config.algo);
+                    let digest = hashes
+                        .as_ref()
+                        .and_then(|h| h.primary_digest(config.algo))
+                        .map(str::to_string);
+                    if let Some(h) = hashes {
+                        peeked.insert(rel, h);
+                    }
+                    (arena.to_path_buf(rel), digest)
+                })
+                .collect();
+            DirIndex::build(items)
+        };
+        let index1 = peek_side(&files1_map, &mut cached1);
+        let index2 = peek_side(&files2_map, &mut cached2);
+
+        // Keep only the top-most matching directories; their descendants are
+        // covered implicitly (DirIndex iterates parents first).
+        for (dir, rollup) in index1.iter() {
+            if let Some(last) = pruned_dirs.last()
+                && dir.starts_with(last)
+            {
+                continue;
+            }
+            if index2.rollup(dir) == Some(rollup) {
+                pruned_dirs.push(dir.clone());
+            }
+        }
+    }
+
+    // Fail-fast: CI only needs a verdict, so check the cheap set differences
+    // first (known without touching any file contents), then cooperatively
+    // cancel the parallel traversal at the first non-match. find_map_any
+    // stops handing out new work as soon as one worker finds a hit.
+    if config.fail_fast {
+        // A tree that was not fully read cannot be declared matching: surface
+        // the walk errors and exit with Error, same as the non-fail-fast path.
+        if !errors1.is_empty() || !errors2.is_empty() {
+            for e in &errors1 {
+                print_error_entry(e, "folder1");
+            }
+            for e in &errors2 {
+                print_error_entry(e, "folder2");
+            }
+            return Ok(ExitStatus::Error);
+        }
+
+        if let Some(id) = files1_map.keys().find(|id| !files2_map.contains_key(id)) {
+            return fail_fast_verdict(Status::Missing, arena.get(*id), false);
+        }
+        if let Some(id) = files2_map.keys().find(|id| !files1_map.contains_key(id)) {
+            return fail_fast_verdict(Status::Extra, arena.get(*id), false);
+        }
+
+        let memo = InodeMemo::new();
+        let first = common_paths.par_iter().find_map_any(|&id| {
+            let rel_path = arena.get(id);
+            if !pruned_dirs.is_empty() && pruned_dirs.iter().any(|d| rel_path.starts_with(d)) {
+                return None;
+            }
+            let entry1 = files1_map.get(&id).unwrap();
+            let entry2 = files2_map.get(&id).unwrap();
+            match compare_files_core(
+                rel_path.to_path_buf(),
+                entry1,
+                entry2,
+                config,
+                cache,
+                Some(&memo),
+            ) {
+                Ok(r) if r.status == Status::Match => None,
+                other => Some(other),
+            }
+        });
+        return match first {
+            Some(Ok(r)) => fail_fast_verdict(r.status, &r.file, false),
+            Some(Err(e)) => Err(e),
+            None => {
+                println!(
+                    "{}: trees match ({} files compared)",
+                    "OK".green().bold(),
+                    common_paths.len()
+                );
+                Ok(ExitStatus::Success)
+            }
+        };
+    }
+
+    // Byte-weighted progress: with skewed size distributions a file count
+    // gives a useless ETA (999 small files done, one 100 GB file left).
+    let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+        let total_bytes: u64 = common_paths
+            .iter()
+            .map(|id| {
+                let s1 = files1_map.get(id).map_or(0, |e| e.size);
+                let s2 = files2_map.get(id).map_or(0, |e| e.size);
+                s1.max(s2).max(1)
+            })
+            .sum();
+        let pb = ProgressBar::new(total_bytes);
         pb.set_style(
             ProgressStyle::default_bar()
-                .template("{spinner:.green} [Elap>{elapsed_precise}] [ {bar:40.cyan/blue} ] {pos}/{len} (Rema>{eta})")?
+                .template("{spinner:.green} [Elap>{elapsed_precise}] [ {bar:40.cyan/blue} ] {bytes}/{total_bytes} (Rema>{eta})")?
                 .progress_chars("#>- ")
         );
         pb.set_draw_target(indicatif::ProgressDrawTarget::stderr_with_hz(10));
@@ -423,34 +728,543 @@ fn run_batch(config: &CompareConfig, start_time: Instant) -> Result<ExitStatus>
     } else {
         None
     };
+    // Flush per-worker every 4 MiB instead of one contended atomic per file.
+    let progress = BatchedProgress::new(pb, 4 << 20);
+
+    // Dedup hashing across hardlinks: within this run each (device, inode)
+    // is hashed at most once no matter how many paths point at it.
+    let memo = InodeMemo::new();
+
+    // One comparison verdict for a common path; shared by the in-memory
+    // path and the spill-to-disk path below.
+    let process = |id: PathId| -> Result<ComparisonResult> {
+        let rel_path = arena.get(id);
+        let entry1 = files1_map.get(&id).unwrap();
+        let entry2 = files2_map.get(&id).unwrap();
+        progress.add(entry1.size.max(entry2.size).max(1));
+
+        // Inside a pruned subtree: both rollups agree, so this is a Match
+        // with the digests the rollup was built from.
+        if !pruned_dirs.is_empty() && pruned_dirs.iter().any(|d| rel_path.starts_with(d)) {
+            return Ok(ComparisonResult {
+                file: rel_path.to_path_buf(),
+                status: Status::Match,
+                hash1: cached1.get(&id).cloned(),
+                hash2: cached2.get(&id).cloned(),
+                size1: Some(entry1.size),
+                size2: Some(entry2.size),
+                modified1: None,
+                modified2: None,
+                symlink1: None,
+                symlink2: None,
+            });
+        }
+
+        compare_files_core(
+            rel_path.to_path_buf(),
+            entry1,
+            entry2,
+            config,
+            cache,
+            Some(&memo),
+        )
+    };
+
+    // Under --memory-limit, results stream through the external sorter
+    // instead of accumulating in a Vec: a channel drains the rayon workers
+    // while this thread buffers, spills and finally merge-streams into the
+    // report writer. Peak memory stays at the budget regardless of tree size.
+    if let Some(budget) = config.memory_limit {
+        let mut sorter = ExternalSorter::new(budget as usize);
+        std::thread::scope(|s| -> Result<()> {
+            let (tx, rx) = std::sync::mpsc::channel::<Result<ComparisonResult>>();
+            let process = &process;
+            let common_paths = &common_paths;
+            s.spawn(move || {
+                common_paths.par_iter().for_each_with(tx, |tx, &id| {
+                    let _ = tx.send(process(id));
+                });
+            });
+            for r in rx {
+                sorter.push(r?)?;
+            }
+            Ok(())
+        })?;
+
+        progress.finish("Comparison complete");
+
+        for id in files1_map.keys() {
+            if !files2_map.contains_key(id) {
+                sorter.push(ComparisonResult::missing(arena.to_path_buf(*id)))?;
+            }
+        }
+        for id in files2_map.keys() {
+            if !files1_map.contains_key(id) {
+                sorter.push(ComparisonResult::extra(arena.to_path_buf(*id)))?;
+            }
+        }
+
+        return finalize_batch_spilled(sorter, &errors1, &errors2, config, start_time);
+    }
 
     let mut all_results: Vec<ComparisonResult> = common_paths
         .par_iter()
-        .map(|rel_path| {
-            if let Some(ref p) = pb {
-                p.inc(1);
-            }
-            let entry1 = files1_map.get(rel_path).unwrap();
-            let entry2 = files2_map.get(rel_path).unwrap();
-            compare_files_core(rel_path.clone(), entry1, entry2, config)
-        })
+        .map(|&id| process(id))
         .collect::<Result<Vec<_>>>()?;
 
-    if let Some(ref p) = pb {
-        p.finish_with_message("Comparison complete");
-    }
+    progress.finish("Comparison complete");
 
     // Fix #12: use constructor helpers instead of large None-filled struct literals
-    for rel_path in set1_paths.difference(&set2_paths) {
-        all_results.push(ComparisonResult::missing((*rel_path).clone()));
+    for id in files1_map.keys() {
+        if !files2_map.contains_key(id) {
+            all_results.push(ComparisonResult::missing(arena.to_path_buf(*id)));
+        }
     }
 
-    for rel_path in set2_paths.difference(&set1_paths) {
-        all_results.push(ComparisonResult::extra((*rel_path).clone()));
+    for id in files2_map.keys() {
+        if !files1_map.contains_key(id) {
+            all_results.push(ComparisonResult::extra(arena.to_path_buf(*id)));
+        }
     }
 
+    finalize_batch(all_results, &errors1, &errors2, config, start_time)
+}
+
+/// Pipelined batch engine: hashing starts while the directory walk is still
+/// running, overlapping metadata I/O with hash computation.
+///
+/// Both walks stream their entries into a merged, tagged channel. The pairing
+/// loop joins the two streams on relative path and hands completed pairs to a
+/// fixed pool of hash workers through a bounded channel, so a slow hashing
+/// stage applies backpressure to the walk instead of buffering the tree.
+/// Entries left unpaired when both walks finish become Missing/Extra.
+fn run_batch_streaming(
+    config: &CompareConfig,
+    cache: Option<&HashCache>,
+    start_time: Instant,
+) -> Result<ExitStatus> {
+    use std::sync::Mutex;
+    use std::sync::mpsc;
+
+    if io::stdout().is_terminal() {
+        println!(
+            "{}",
+            "==============================================".bright_blue()
+        );
+        println!("  Folder File Comparison Utility (Batch Mode)");
+        println!(
+            "{}",
+            "==============================================".bright_blue()
+        );
+        println!();
+    }
+
+    let (tx1, rx1) = mpsc::sync_channel(WALK_CHANNEL_CAP);
+    let (tx_err1, rx_err1) = mpsc::channel();
+    stream_files(
+        &config.folder1,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+        tx1,
+        tx_err1,
+    )?;
+
+    let (tx2, rx2) = mpsc::sync_channel(WALK_CHANNEL_CAP);
+    let (tx_err2, rx_err2) = mpsc::channel();
+    stream_files(
+        &config.folder2,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+        tx2,
+        tx_err2,
+    )?;
+
+    // Merge both walk streams into one channel, tagging each entry with its
+    // side, so the pairing loop below can consume them as they arrive.
+    let (merged_tx, merged_rx) = mpsc::sync_channel::<(u8, FileEntry)>(WALK_CHANNEL_CAP);
+    for (side, rx) in [(0u8, rx1), (1u8, rx2)] {
+        let merged_tx = merged_tx.clone();
+        std::thread::spawn(move || {
+            for entry in rx {
+                if merged_tx.send((side, entry)).is_err() {
+                    break;
+                }
+            }
+        });
+    }
+    drop(merged_tx);
+
+    // Total is unknown while the walk is running, so use a counting spinner.
+    let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+        let pb = ProgressBar::new_spinner();
+        pb.set_style(
+            ProgressStyle::default_spinner()
+                .template("{spinner:.green} [Elap>{elapsed_precise}] {pos} files compared")?,
+        );
+        pb.set_draw_target(indicatif::ProgressDrawTarget::stderr_with_hz(10));
+        Some(pb)
+    } else {
+        None
+    };
+    let progress = BatchedProgress::new(pb, 64);
+
+    let (pair_tx, pair_rx) = mpsc::sync_channel::<(PathBuf, FileEntry, FileEntry)>(WALK_CHANNEL_CAP);
+    let pair_rx = Mutex::new(pair_rx);
+    let (res_tx, res_rx) = mpsc::channel::<Result<ComparisonResult>>();
+
+    let mut pending1: HashMap<PathBuf, FileEntry> = HashMap::new();
+    let mut pending2: HashMap<PathBuf, FileEntry> = HashMap::new();
+
+    // in_place_scope: the pairing loop below runs on this thread and owns the
+    // non-Sync receivers; only the hash workers are spawned into the pool.
+    rayon::in_place_scope(|s| -> Result<()> {
+        for _ in 0..rayon::current_num_threads() {
+            let res_tx = res_tx.clone();
+            let pair_rx = &pair_rx;
+            let progress = &progress;
+            s.spawn(move |_| {
+                loop {
+                    // Lock only for the recv itself so workers don't serialise
+                    // on each other while hashing.
+                    let job = pair_rx.lock().unwrap().recv();
+                    match job {
+                        Ok((rel_path, entry1, entry2)) => {
+                            let result =
+                                compare_files_core(rel_path, &entry1, &entry2, config, cache, None);
+                            progress.add(1);
+                            if res_tx.send(result).is_err() {
+                                break;
+                            }
+                        }
+                        Err(_) => break,
+                    }
+                }
+            });
+        }
+
+        for (side, entry) in merged_rx.iter() {
+            let root = if side == 0 {
+                &config.folder1
+            } else {
+                &config.folder2
+            };
+            let rel_path = entry.path.strip_prefix(root)?.to_path_buf();
+
+            let pair = if side == 0 {
+                match pending2.remove(&rel_path) {
+                    Some(entry2) => Some((rel_path, entry, entry2)),
+                    None => {
+                        pending1.insert(rel_path, entry);
+                        None
+                    }
+                }
+            } else {
+                match pending1.remove(&rel_path) {
+                    Some(entry1) => Some((rel_path, entry1, entry)),
+                    None => {
+                        pending2.insert(rel_path, entry);
+                        None
+                    }
+                }
+            };
+
+            if let Some(pair) = pair {
+                pair_tx
+                    .send(pair)
+                    .map_err(|_| anyhow::anyhow!("hash worker pool shut down unexpectedly"))?;
+            }
+        }
+
+        drop(pair_tx);
+        Ok(())
+    })?;
+    drop(res_tx);
+
+    let mut all_results = Vec::new();
+    for result in res_rx {
+        all_results.push(result?);
+    }
+
+    progress.finish("Comparison complete");
+
+    // Whatever never found a partner on the other side is Missing/Extra.
+    for rel_path in pending1.into_keys() {
+        all_results.push(ComparisonResult::missing(rel_path));
+    }
+    for rel_path in pending2.into_keys() {
+        all_results.push(ComparisonResult::extra(rel_path));
+    }
+
+    let errors1: Vec<ErrorEntry> = rx_err1.into_iter().collect();
+    let errors2: Vec<ErrorEntry> = rx_err2.into_iter().collect();
+
+    finalize_batch(all_results, &errors1, &errors2, config, start_time)
+}
+
+/// Print the single offending path — unless the engine already emitted it
+/// to its report sink — and return the fail-fast verdict.
+fn fail_fast_verdict(status: Status, path: &Path, already_emitted: bool) -> Result<ExitStatus> {
+    if !already_emitted {
+        println!("[{}]  {}", status.to_string().red().bold(), path.display());
+    }
+    println!("Fail-fast: first difference found, stopping.");
+    Ok(ExitStatus::Diff)
+}
+
+/// Write one merge-engine result to the streaming sink in the configured
+/// format.
+fn emit_merge_result(
+    sink: &mut dyn io::Write,
+    result: &ComparisonResult,
+    ndjson: bool,
+    config: &CompareConfig,
+) -> Result<()> {
+    if ndjson {
+        write_ndjson_result(sink, result)
+    } else {
+        sink.write_all(result.format_text(config.verbose, config.algo)?.as_bytes())?;
+        Ok(())
+    }
+}
+
+/// Merge-join batch engine: walks both trees in the same deterministic sorted
+/// order and joins the two streams on the fly, so no path map, key set or
+/// common-paths Vec is ever materialised — memory stays O(1) per entry.
+///
+/// Results are streamed straight to the report sink as they are produced,
+/// which also means first output appears while the walk is still running.
+/// The trade-off versus the other engines is per-pair hashing parallelism
+/// only (the rayon::join inside compare_files_core), not across files.
+fn run_merge(
+    config: &CompareConfig,
+    cache: Option<&HashCache>,
+    start_time: Instant,
+) -> Result<ExitStatus> {
+    if config.output_format == OutputFormat::Json {
+        anyhow::bail!(
+            "--engine merge streams results and supports the txt and ndjson report formats"
+        );
+    }
+    let ndjson = config.output_format == OutputFormat::Ndjson;
+
+    if io::stdout().is_terminal() {
+        println!(
+            "{}",
+            "==============================================".bright_blue()
+        );
+        println!("  Folder File Comparison Utility (Batch Mode)");
+        println!(
+            "{}",
+            "==============================================".bright_blue()
+        );
+        println!();
+    }
+
+    let mut it1 = walk_sorted(
+        &config.folder1,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+    )?;
+    let mut it2 = walk_sorted(
+        &config.folder2,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+    )?;
+
+    use std::io::Write;
+
+    let (mut sink, report_path) = open_report_sink(
+        &config.output_folder,
+        report_filename(config.output_format),
+    )?;
+
+    let mut matches = 0;
+    let mut diffs = 0;
+    let mut missing = 0;
+    let mut extra = 0;
+    let mut total_errors = 0;
+
+    let mut a = it1.next();
+    let mut b = it2.next();
+
+    loop {
+        match (a.take(), b.take()) {
+            (None, None) => break,
+            (Some(Err(e)), rest_b) => {
+                if ndjson {
+                    write_ndjson_error(&mut *sink, &e, "folder1")?;
+                } else {
+                    writeln!(
+                        sink,
+                        "[{}] {} (folder1: {})",
+                        "ERROR".red().on_white(),
+                        e.path.display(),
+                        e.error
+                    )?;
+                }
+                total_errors += 1;
+                a = it1.next();
+                b = rest_b;
+            }
+            (rest_a, Some(Err(e))) => {
+                if ndjson {
+                    write_ndjson_error(&mut *sink, &e, "folder2")?;
+                } else {
+                    writeln!(
+                        sink,
+                        "[{}] {} (folder2: {})",
+                        "ERROR".red().on_white(),
+                        e.path.display(),
+                        e.error
+                    )?;
+                }
+                total_errors += 1;
+                a = rest_a;
+                b = it2.next();
+            }
+            (Some(Ok(entry1)), None) => {
+                let rel = entry1.path.strip_prefix(&config.folder1)?.to_path_buf();
+                let result = ComparisonResult::missing(rel);
+                missing += 1;
+                emit_merge_result(&mut *sink, &result, ndjson, config)?;
+                if config.fail_fast {
+                    sink.flush()?;
+                    return fail_fast_verdict(result.status, &result.file, true);
+                }
+                a = it1.next();
+                b = None;
+            }
+            (None, Some(Ok(entry2))) => {
+                let rel = entry2.path.strip_prefix(&config.folder2)?.to_path_buf();
+                let result = ComparisonResult::extra(rel);
+                extra += 1;
+                emit_merge_result(&mut *sink, &result, ndjson, config)?;
+                if config.fail_fast {
+                    sink.flush()?;
+                    return fail_fast_verdict(result.status, &result.file, true);
+                }
+                a = None;
+                b = it2.next();
+            }
+            (Some(Ok(entry1)), Some(Ok(entry2))) => {
+                let rel1 = entry1.path.strip_prefix(&config.folder1)?.to_path_buf();
+                let rel2 = entry2.path.strip_prefix(&config.folder2)?.to_path_buf();
+
+                // Component-wise Path ordering matches the sorted traversal
+                // order of walk_sorted, so a plain three-way compare drives
+                // the merge correctly.
+                match rel1.cmp(&rel2) {
+                    std::cmp::Ordering::Less => {
+                        let result = ComparisonResult::missing(rel1);
+                        missing += 1;
+                        emit_merge_result(&mut *sink, &result, ndjson, config)?;
+                        if config.fail_fast {
+                            sink.flush()?;
+                            return fail_fast_verdict(result.status, &result.file, true);
+                        }
+                        a = it1.next();
+                        b = Some(Ok(entry2));
+                    }
+                    std::cmp::Ordering::Greater => {
+                        let result = ComparisonResult::extra(rel2);
+                        extra += 1;
+                        emit_merge_result(&mut *sink, &result, ndjson, config)?;
+                        if config.fail_fast {
+                            sink.flush()?;
+                            return fail_fast_verdict(result.status, &result.file, true);
+                        }
+                        a = Some(Ok(entry1));
+                        b = it2.next();
+                    }
+                    std::cmp::Ordering::Equal => {
+                        let result =
+                            compare_files_core(rel1, &entry1, &entry2, config, cache, None)?;
+                        match result.status {
+                            Status::Match => matches += 1,
+                            Status::Diff => diffs += 1,
+                            _ => (),
+                        }
+                        emit_merge_result(&mut *sink, &result, ndjson, config)?;
+                        if config.fail_fast && result.status != Status::Match {
+                            sink.flush()?;
+                            return fail_fast_verdict(result.status, &result.file, true);
+                        }
+                        a = it1.next();
+                        b = it2.next();
+                    }
+                }
+            }
+        }
+    }
+
+    let summary_data = SummaryData {
+        total: matches + diffs + missing + extra,
+        matches,
+        diffs,
+        missing,
+        extra,
+        errors: total_errors,
+        elapsed: start_time.elapsed(),
+    };
+    let report_conf = ReportConfig {
+        mode: config.mode,
+        algo: config.algo,
+        threads: config.threads,
+        verbose: config.verbose,
+    };
+
+    if ndjson {
+        write_ndjson_summary(&mut *sink, &summary_data)?;
+    } else {
+        writeln!(sink)?;
+        for line in generate_summary_text(&summary_data, &report_conf) {
+            writeln!(sink, "{}", line)?;
+        }
+    }
+    finish_report_sink(sink, report_path)?;
+
+    if total_errors > 0 {
+        Ok(ExitStatus::Error)
+    } else if diffs > 0 || missing > 0 || extra > 0 {
+        Ok(ExitStatus::Diff)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
+
+/// Shared tail of the batch engines: sort, tally, render the report and map
+/// the counters onto an exit status.
+fn finalize_batch(
+    mut all_results: Vec<ComparisonResult>,
+    errors1: &[ErrorEntry],
+    errors2: &[ErrorEntry],
+    config: &CompareConfig,
+    start_time: Instant,
+) -> Result<ExitStatus> {
+    let total_errors = errors1.len() + errors2.len();
+
     if !config.no_sort {
+        let sort_timer = crate::stats::enabled().then(Instant::now);
         all_results.sort_by(|a, b| a.file.cmp(&b.file));
+        if let Some(t) = sort_timer {
+            crate::stats::record_sort(t.elapsed());
+        }
     }
 
     let mut matches = 0;
@@ -486,22 +1300,122 @@ fn run_batch(config: &CompareConfig, start_time: Instant) -> Result<ExitStatus>
         elapsed,
     };
 
+    let (mut sink, report_path) = open_report_sink(
+        &config.output_folder,
+        report_filename(config.output_format),
+    )?;
     match config.output_format {
-        OutputFormat::Txt => {
-            let output = generate_text_report(
-                &all_results,
-                &errors1,
-                &errors2,
-                &summary_data,
-                &report_conf,
+        OutputFormat::Txt => write_text_report(
+            &mut *sink,
+            &all_results,
+            errors1,
+            errors2,
+            &summary_data,
+            &report_conf,
+        )?,
+        OutputFormat::Json => {
+            write_json_report(&mut *sink, &all_results, errors1, errors2, &summary_data)?
+        }
+        OutputFormat::Ndjson => {
+            write_ndjson_report(&mut *sink, &all_results, errors1, errors2, &summary_data)?
+        }
+    }
+    finish_report_sink(sink, report_path)?;
+
+    if total_errors > 0 {
+        Ok(ExitStatus::Error)
+    } else if diffs > 0 || missing > 0 || extra > 0 {
+        Ok(ExitStatus::Diff)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
+
+/// Report writing for the --memory-limit path: results arrive through the
+/// external sorter's k-way merge already in path order and are written one
+/// at a time, so nothing is ever re-materialised in memory. Status counts
+/// accumulate during the pass — txt and ndjson both put the summary last,
+/// which is what makes the single pass possible; the json document puts it
+/// first, so run_batch rejects that format before any hashing starts.
+fn finalize_batch_spilled(
+    sorter: ExternalSorter,
+    errors1: &[ErrorEntry],
+    errors2: &[ErrorEntry],
+    config: &CompareConfig,
+    start_time: Instant,
+) -> Result<ExitStatus> {
+    let total_errors = errors1.len() + errors2.len();
+    let total = sorter.len();
+    let ndjson = config.output_format == OutputFormat::Ndjson;
+
+    let report_conf = ReportConfig {
+        mode: config.mode,
+        algo: config.algo,
+        threads: config.threads,
+        verbose: config.verbose,
+    };
+
+    let (mut sink, report_path) = open_report_sink(
+        &config.output_folder,
+        report_filename(config.output_format),
+    )?;
+
+    for (errors, source) in [(errors1, "folder1"), (errors2, "folder2")] {
+        for e in errors {
+            if ndjson {
+                write_ndjson_error(&mut *sink, e, source)?;
+            } else {
+                writeln!(
+                    sink,
+                    "[{}] {} ({}: {})",
+                    "ERROR".red().on_white(),
+                    e.path.display(),
+                    source,
+                    e.error
+                )?;
+            }
+        }
+    }
+
+    let (mut matches, mut diffs, mut missing, mut extra) = (0, 0, 0, 0);
+    for result in sorter.into_sorted_iter()? {
+        let result = result?;
+        match result.status {
+            Status::Match => matches += 1,
+            Status::Diff => diffs += 1,
+            Status::Missing => missing += 1,
+            Status::Extra => extra += 1,
+            _ => (),
+        }
+        if ndjson {
+            write_ndjson_result(&mut *sink, &result)?;
+        } else {
+            sink.write_all(
+                result
+                    .format_text(report_conf.verbose, report_conf.algo)?
+                    .as_bytes(),
             )?;
-            write_report(output, &config.output_folder, "report.txt")?;
         }
-        OutputFormat::Json => {
-            let output = generate_json_report(&all_results, &errors1, &errors2, &summary_data)?;
-            write_report(output, &config.output_folder, "report.json")?;
+    }
+
+    let summary_data = SummaryData {
+        total,
+        matches,
+        diffs,
+        missing,
+        extra,
+        errors: total_errors,
+        elapsed: start_time.elapsed(),
+    };
+    if ndjson {
+        write_ndjson_summary(&mut *sink, &summary_data)?;
+    } else {
+        writeln!(sink)?;
+        for line in generate_summary_text(&summary_data, &report_conf) {
+            writeln!(sink, "{}", line)?;
         }
     }
+    finish_report_sink(sink, report_path)?;
 
     if total_errors > 0 {
         Ok(ExitStatus::Error)
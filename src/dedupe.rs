@@ -0,0 +1,227 @@
+//! Duplicate-file detection inside a single tree, built on the existing
+//! parallel walk and hashing engine.
+//!
+//! Files are grouped by size first and only size-colliding groups are
+//! hashed — a file with a unique length cannot have a duplicate, so on
+//! typical trees the vast majority of bytes are never read. Hardlinks
+//! (same device+inode) are collapsed to one representative per group:
+//! they already share storage, so reporting them as reclaimable would
+//! overstate the savings.
+
+use anyhow::Result;
+use colored::*;
+use indicatif::{ProgressBar, ProgressStyle};
+use rayon::prelude::*;
+use std::collections::HashMap;
+use std::io::{self, IsTerminal, Write};
+use std::path::PathBuf;
+use std::time::Instant;
+
+use crate::compare::ExitStatus;
+use crate::models::{FileEntry, HashAlgo, OutputFormat, SymlinkMode};
+use crate::report::{open_report_sink, print_error_entry, report_filename};
+use crate::utils::{collect_files, compute_hashes};
+
+pub struct DedupeConfig {
+    pub folder: PathBuf,
+    pub algo: HashAlgo,
+    pub output_folder: Option<PathBuf>,
+    pub output_format: OutputFormat,
+    pub depth: Option<usize>,
+    pub no_recursive: bool,
+    pub hidden: bool,
+    pub types: Option<Vec<String>>,
+    pub ignore: Option<Vec<String>>,
+    pub symlinks: SymlinkMode,
+    pub threads: Option<usize>,
+}
+
+/// One cluster of byte-identical files.
+#[derive(serde::Serialize)]
+pub struct DuplicateCluster {
+    pub digest: String,
+    pub size: u64,
+    pub files: Vec<PathBuf>,
+    /// Bytes freed by keeping one copy: size × (files − 1).
+    pub reclaimable: u64,
+}
+
+pub fn run_dedupe(config: DedupeConfig) -> Result<ExitStatus> {
+    let start_time = Instant::now();
+
+    // Fix #5: silently ignore if global pool is already initialised
+    if let Some(num_threads) = config.threads {
+        let _ = rayon::ThreadPoolBuilder::new()
+            .num_threads(num_threads)
+            .build_global();
+    }
+
+    if io::stdout().is_terminal() {
+        println!("{}", "Scanning for duplicates...".bright_cyan());
+    }
+
+    let (files, errors) = collect_files(
+        &config.folder,
+        config.depth,
+        config.no_recursive,
+        config.hidden,
+        &config.types,
+        &config.ignore,
+        config.symlinks,
+    )?;
+    for e in &errors {
+        print_error_entry(e, "folder");
+    }
+
+    // Size grouping: unique sizes cannot collide, zero-byte files have
+    // nothing to reclaim. Within a group, keep one path per (dev, inode)
+    // so hardlink farms are not misreported as duplicated data.
+    let mut by_size: HashMap<u64, Vec<FileEntry>> = HashMap::new();
+    for f in files {
+        if f.size > 0 {
+            by_size.entry(f.size).or_default().push(f);
+        }
+    }
+    let mut candidates: Vec<FileEntry> = by_size
+        .into_values()
+        .filter(|group| group.len() > 1)
+        .flat_map(|group| {
+            let mut seen_inodes = std::collections::HashSet::new();
+            group
+                .into_iter()
+                .filter(move |f| match f.file_id {
+                    Some(id) => seen_inodes.insert(id),
+                    None => true,
+                })
+                .collect::<Vec<_>>()
+        })
+        .collect();
+    // Largest-first, same as run_batch: the biggest candidates start
+    // hashing while there is still other work to overlap them with.
+    candidates.sort_unstable_by_key(|f| std::cmp::Reverse(f.size));
+
+    let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+        let pb = ProgressBar::new(candidates.len() as u64);
+        pb.set_style(
+            ProgressStyle::default_bar()
+                .template("{spinner:.green} Hashing candidates {bar:40.cyan/blue} {pos}/{len}")?,
+        );
+        Some(pb)
+    } else {
+        None
+    };
+
+    let hashed: Vec<(String, FileEntry)> = candidates
+        .into_par_iter()
+        .map(|f| -> Result<Option<(String, FileEntry)>> {
+            if let Some(ref p) = pb {
+                p.inc(1);
+            }
+            let h = compute_hashes(&f.path, config.algo)?;
+            Ok(h
+                .primary_digest(config.algo)
+                .map(|d| (d.to_string(), f)))
+        })
+        .filter_map(|r| r.transpose())
+        .collect::<Result<Vec<_>>>()?;
+
+    if let Some(ref p) = pb {
+        p.finish_with_message("Hashing complete");
+    }
+
+    let mut by_digest: HashMap<String, Vec<FileEntry>> = HashMap::new();
+    for (digest, f) in hashed {
+        by_digest.entry(digest).or_default().push(f);
+    }
+
+    let mut clusters: Vec<DuplicateCluster> = by_digest
+        .into_iter()
+        .filter(|(_, group)| group.len() > 1)
+        .map(|(digest, group)| {
+            let size = group[0].size;
+            let mut files: Vec<PathBuf> = group.into_iter().map(|f| f.path).collect();
+            files.sort();
+            let reclaimable = size * (files.len() as u64 - 1);
+            DuplicateCluster {
+                digest,
+                size,
+                files,
+                reclaimable,
+            }
+        })
+        .collect();
+    // Biggest wins first: that is what someone clearing a volume acts on.
+    clusters.sort_by_key(|c| std::cmp::Reverse(c.reclaimable));
+
+    let total_reclaimable: u64 = clusters.iter().map(|c| c.reclaimable).sum();
+    let duplicate_files: usize = clusters.iter().map(|c| c.files.len() - 1).sum();
+
+    let (mut sink, report_path) = open_report_sink(
+        &config.output_folder,
+        report_filename(config.output_format),
+    )?;
+    match config.output_format {
+        OutputFormat::Txt => {
+            for c in &clusters {
+                writeln!(
+                    sink,
+                    "{} {} files × {} bytes ({} reclaimable) [{}…]",
+                    "DUP".yellow().bold(),
+                    c.files.len(),
+                    c.size,
+                    c.reclaimable,
+                    &c.digest[..c.digest.len().min(12)]
+                )?;
+                for f in &c.files {
+                    writeln!(sink, "    {}", f.display())?;
+                }
+            }
+            writeln!(sink)?;
+            writeln!(
+                sink,
+                "{} clusters, {} duplicate files, {} bytes reclaimable ({:.2?})",
+                clusters.len(),
+                duplicate_files,
+                total_reclaimable,
+                start_time.elapsed()
+            )?;
+        }
+        OutputFormat::Json => {
+            let doc = serde_json::json!({
+                "summary": {
+                    "clusters": clusters.len(),
+                    "duplicate_files": duplicate_files,
+                    "reclaimable_bytes": total_reclaimable,
+                    "time_taken": format!("{:.2?}", start_time.elapsed()),
+                },
+                "clusters": clusters,
+            });
+            serde_json::to_writer(&mut *sink, &doc)?;
+            writeln!(sink)?;
+        }
+        OutputFormat::Ndjson => {
+            for c in &clusters {
+                serde_json::to_writer(&mut *sink, c)?;
+                writeln!(sink)?;
+            }
+            serde_json::to_writer(
+                &mut *sink,
+                &serde_json::json!({"summary": {
+                    "clusters": clusters.len(),
+                    "duplicate_files": duplicate_files,
+                    "reclaimable_bytes": total_reclaimable,
+                }}),
+            )?;
+            writeln!(sink)?;
+        }
+    }
+    crate::report::finish_report_sink(sink, report_path)?;
+
+    if !errors.is_empty() {
+        Ok(ExitStatus::Error)
+    } else if clusters.is_empty() {
+        Ok(ExitStatus::Success)
+    } else {
+        Ok(ExitStatus::Diff)
+    }
+}
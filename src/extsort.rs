@@ -0,0 +1,180 @@
+//! External-memory sorting of comparison results.
+//!
+//! `run_batch` used to hold every `ComparisonResult` in one Vec and sort
+//! it before report generation; at tens of millions of entries with hex
+//! digest strings attached that exceeds RAM. Under `--memory-limit` the
+//! results go through this sorter instead: once the in-memory buffer hits
+//! the budget it is sorted by path and spilled to an unlinked temp file as
+//! one NDJSON run, and report writing k-way merges the runs with the
+//! final buffer. Peak memory is the budget plus one record per run,
+//! independent of tree size.
+
+use anyhow::{Context, Result};
+use std::collections::BinaryHeap;
+use std::fs::File;
+use std::io::{BufRead, BufReader, BufWriter, Seek, SeekFrom, Write};
+
+use crate::models::ComparisonResult;
+
+/// Rough per-record heap footprint used against the memory budget: the
+/// serialized length tracks the path and digest strings, the constant
+/// covers struct overhead and allocator slack. A budget estimator, not an
+/// accounting system.
+fn estimate_size(r: &ComparisonResult) -> usize {
+    let strings = r.file.as_os_str().len()
+        + [&r.hash1, &r.hash2]
+            .into_iter()
+            .flatten()
+            .map(|h| {
+                [&h.sha256, &h.blake3, &h.xxh3]
+                    .into_iter()
+                    .flatten()
+                    .map(String::len)
+                    .sum::<usize>()
+            })
+            .sum::<usize>();
+    strings + 256
+}
+
+pub struct ExternalSorter {
+    budget: usize,
+    buffered: usize,
+    buffer: Vec<ComparisonResult>,
+    runs: Vec<File>,
+    total: usize,
+}
+
+impl ExternalSorter {
+    pub fn new(budget_bytes: usize) -> Self {
+        ExternalSorter {
+            budget: budget_bytes.max(1),
+            buffered: 0,
+            buffer: Vec::new(),
+            runs: Vec::new(),
+            total: 0,
+        }
+    }
+
+    pub fn push(&mut self, result: ComparisonResult) -> Result<()> {
+        self.buffered += estimate_size(&result);
+        self.buffer.push(result);
+        self.total += 1;
+        if self.buffered >= self.budget {
+            self.spill()?;
+        }
+        Ok(())
+    }
+
+    /// Number of results pushed so far.
+    pub fn len(&self) -> usize {
+        self.total
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.total == 0
+    }
+
+    /// Sort the buffer and write it out as one run. The temp file is
+    /// created unlinked (`tempfile::tempfile`), so runs vanish with the
+    /// process even on a crash.
+    fn spill(&mut self) -> Result<()> {
+        self.buffer.sort_by(|a, b| a.file.cmp(&b.file));
+        let mut out = BufWriter::new(
+            tempfile::tempfile().context("Cannot create spill file for --memory-limit")?,
+        );
+        for r in &self.buffer {
+            serde_json::to_writer(&mut out, r)?;
+            writeln!(out)?;
+        }
+        let mut file = out.into_inner()?;
+        file.seek(SeekFrom::Start(0))?;
+        self.runs.push(file);
+        self.buffer.clear();
+        self.buffered = 0;
+        Ok(())
+    }
+
+    /// Consume the sorter, yielding all results in ascending path order.
+    pub fn into_sorted_iter(mut self) -> Result<MergeIter> {
+        self.buffer.sort_by(|a, b| a.file.cmp(&b.file));
+        let mut sources: Vec<RunSource> = self
+            .runs
+            .into_iter()
+            .map(|f| RunSource::Spilled(BufReader::new(f).lines()))
+            .collect();
+        sources.push(RunSource::Memory(self.buffer.into_iter()));
+
+        let mut heap = BinaryHeap::with_capacity(sources.len());
+        for (idx, source) in sources.iter_mut().enumerate() {
+            if let Some(r) = source.next_result()? {
+                heap.push(HeapEntry { result: r, source: idx });
+            }
+        }
+        Ok(MergeIter { sources, heap })
+    }
+}
+
+enum RunSource {
+    Spilled(std::io::Lines<BufReader<File>>),
+    Memory(std::vec::IntoIter<ComparisonResult>),
+}
+
+impl RunSource {
+    fn next_result(&mut self) -> Result<Option<ComparisonResult>> {
+        match self {
+            RunSource::Spilled(lines) => match lines.next() {
+                Some(line) => Ok(Some(serde_json::from_str(&line?)?)),
+                None => Ok(None),
+            },
+            RunSource::Memory(iter) => Ok(iter.next()),
+        }
+    }
+}
+
+/// BinaryHeap is a max-heap, so order entries by *reversed* path compare
+/// to pop the smallest path first.
+struct HeapEntry {
+    result: ComparisonResult,
+    source: usize,
+}
+
+impl PartialEq for HeapEntry {
+    fn eq(&self, other: &Self) -> bool {
+        self.result.file == other.result.file
+    }
+}
+impl Eq for HeapEntry {}
+impl PartialOrd for HeapEntry {
+    fn partial_cmp(&self, other: &Self) -> Option<std::cmp::Ordering> {
+        Some(self.cmp(other))
+    }
+}
+impl Ord for HeapEntry {
+    fn cmp(&self, other: &Self) -> std::cmp::Ordering {
+        other.result.file.cmp(&self.result.file)
+    }
+}
+
+/// K-way merge over the spilled runs plus the final in-memory buffer.
+/// Holds one record per source; everything else stays on disk until read.
+pub struct MergeIter {
+    sources: Vec<RunSource>,
+    heap: BinaryHeap<HeapEntry>,
+}
+
+impl Iterator for MergeIter {
+    type Item = Result<ComparisonResult>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        let entry = self.heap.pop()?;
+        match self.sources[entry.source].next_result() {
+            Ok(Some(r)) => self.heap.push(HeapEntry {
+                result: r,
+                source: entry.source,
+            }),
+            Ok(None) => (),
+            Err(e) => return Some(Err(e)),
+        }
+        Some(Ok(entry.result))
+    }
+}
@@ -0,0 +1,25 @@
+//! Library surface of the cmpf binary.
+//!
+//! The modules live here rather than in main.rs so that the criterion
+//! suite in benches/ can drive the same code paths the CLI uses
+//! (`collect_files`, `compute_hashes`, `run_compare`, ...). The binary in
+//! main.rs is a thin clap front-end over these modules.
+
+pub mod agent;
+pub mod cache;
+pub mod compare;
+pub mod dedupe;
+pub mod delta;
+pub mod extsort;
+pub mod models;
+pub mod multiway;
+pub mod report;
+pub mod snapfmt;
+pub mod snapshot;
+pub mod stats;
+pub mod sync;
+pub mod utils;
+pub mod watch;
+
+#[cfg(test)]
+mod tests;
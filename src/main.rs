@@ -2,26 +2,24 @@
 #[global_allocator]
 static GLOBAL: mimalloc::MiMalloc = mimalloc::MiMalloc;
 
-mod compare;
-mod models;
-mod report;
-mod snapshot;
-mod sync;
-mod utils;
-
-#[cfg(test)]
-mod tests;
-
 use anyhow::Result;
 use clap::{Parser, Subcommand};
 use colored::control;
 use std::io::IsTerminal;
 use std::path::PathBuf;
 
-use crate::compare::{CompareConfig, ExitStatus, run_compare};
-use crate::models::{HashAlgo, Mode, OutputFormat, SymlinkMode};
-use crate::snapshot::{SnapshotConfig, VerifyConfig, create_snapshot, verify_snapshot};
-use crate::sync::{SyncConfig, run_sync};
+use cmpf::agent::{AgentConfig, RemoteCompareConfig, parse_remote_spec, run_agent, run_remote_compare};
+use cmpf::compare::{CompareConfig, ExitStatus, run_compare};
+use cmpf::dedupe::{DedupeConfig, run_dedupe};
+use cmpf::models::{CopyMode, Engine, HashAlgo, Mode, OutputFormat, SnapshotFormat, SymlinkMode};
+use cmpf::multiway::{MultiwayConfig, run_multiway};
+use cmpf::snapshot::{
+    DiffSnapshotsConfig, SnapshotConfig, VerifyConfig, create_snapshot, diff_snapshots,
+    verify_snapshot,
+};
+use cmpf::stats;
+use cmpf::sync::{SyncConfig, run_sync};
+use cmpf::watch::run_watch;
 
 #[derive(Parser)]
 #[command(
@@ -43,7 +41,7 @@ struct Cli {
     folder2: Option<PathBuf>,
 
     #[arg(short, long, value_enum, default_value_t = Mode::Batch, global = true)]
-    /// Processing mode: Realtime (sequential), Batch (parallel report), or Metadata (skip hashing)
+    /// Processing mode: Realtime (live output), Batch (parallel report), Metadata (skip hashing), or Bytes (early-exit byte comparison)
     mode: Mode,
     #[arg(short, long, value_enum, default_value_t = HashAlgo::Blake3, global = true)]
     /// Hashing algorithm to use for file comparison
@@ -84,20 +82,88 @@ struct Cli {
     /// Command to use for external diff (e.g., "code --diff", "vimdiff")
     #[arg(long, value_name = "COMMAND", global = true)]
     diff_cmd: Option<String>,
+    #[arg(long, default_value_t = false, global = true)]
+    /// Reuse digests from the persistent hash cache for files whose size and mtime are unchanged
+    cache: bool,
+    #[arg(long, value_name = "DIR", requires = "cache", global = true)]
+    /// Directory for the persistent hash cache (default: ~/.cache/cmpf)
+    cache_dir: Option<PathBuf>,
+    #[arg(long, value_enum, default_value_t = Engine::Classic, global = true)]
+    /// (Batch mode only) Execution engine for the comparison
+    engine: Engine,
+    #[arg(long, value_name = "BLOCKS", num_args = 0..=1, default_missing_value = "8", global = true)]
+    /// Hash only first/last plus BLOCKS evenly spaced 1 MiB blocks per file (fast check for huge media files)
+    hash_sample: Option<usize>,
+    #[arg(long, default_value_t = false, global = true)]
+    /// Emit per-phase timing counters (walk, hash, map build, sort, apply) as JSON on stderr
+    stats: bool,
+    #[arg(long, default_value_t = false, global = true)]
+    /// Stop at the first difference and exit immediately (CI gating; classic and merge engines)
+    fail_fast: bool,
+    #[arg(long, value_name = "COMMAND", default_value = "cmpf", global = true)]
+    /// Command used to launch the remote agent when comparing against host:path
+    remote_cmd: String,
+    #[arg(long, default_value_t = false, global = true)]
+    /// Evict each file from the page cache after hashing it (Linux; keeps large verification runs from displacing other workloads' cached data)
+    drop_cache: bool,
+    #[arg(long, value_name = "MIB", global = true)]
+    /// Minimum file size in MiB before one file is hashed on multiple cores (default 128; applies to blake3 and sha256-tree)
+    par_hash_threshold: Option<u64>,
+    #[arg(long, value_name = "MIB", global = true)]
+    /// Buffer at most this many MiB of results in memory, spilling sorted runs to disk (compare batch engine and verify; txt/ndjson output only)
+    memory_limit: Option<u64>,
+    #[arg(short = 'q', long, default_value_t = false, global = true)]
+    /// Suppress per-file output and progress bars; reports, summaries and errors still print
+    quiet: bool,
 }
 
 #[derive(Subcommand)]
 enum Commands {
-    /// Standard comparison between two folders
-    Compare { folder1: PathBuf, folder2: PathBuf },
+    /// Standard comparison between two folders (pass more for N-way replica verification)
+    Compare {
+        folder1: PathBuf,
+        folder2: PathBuf,
+        /// Additional replicas; with any present, every file is hashed once
+        /// and per-path agreement is reported across all folders
+        extra: Vec<PathBuf>,
+    },
     /// Create a snapshot of a folder's state
     Snapshot {
         folder: PathBuf,
-        #[arg(short, long)]
+        // No short flag: `-o` already belongs to the global --output-folder
+        // and clap's debug asserts reject the collision.
+        #[arg(long)]
         output: Option<PathBuf>,
+        /// On-disk snapshot format (binary is compact and mmap-friendly; json for interchange)
+        #[arg(long, value_enum, default_value_t = SnapshotFormat::Binary)]
+        format: SnapshotFormat,
+    },
+    /// Compare two snapshot files against each other without touching the data
+    DiffSnapshots {
+        snapshot1: PathBuf,
+        snapshot2: PathBuf,
     },
     /// Verify a folder against a previously created snapshot
-    Verify { folder: PathBuf, snapshot: PathBuf },
+    Verify {
+        folder: PathBuf,
+        snapshot: PathBuf,
+        /// Trust entries whose size and mtime match the snapshot; hash only changed or suspicious files
+        #[arg(long)]
+        quick: bool,
+    },
+    /// Find duplicate files inside a single folder
+    Dedupe { folder: PathBuf },
+    /// Scan and hash a folder, streaming a digest manifest to stdout
+    /// (the remote end of `compare <local> host:path`)
+    Agent { folder: PathBuf },
+    /// Watch two folders and incrementally re-compare paths as they change
+    Watch {
+        folder1: PathBuf,
+        folder2: PathBuf,
+        /// Quiet window after a filesystem event before re-checking, in milliseconds
+        #[arg(long, value_name = "MS", default_value_t = 200)]
+        debounce: u64,
+    },
     /// Sync changes from source to destination
     Sync {
         /// Source folder
@@ -117,6 +183,12 @@ enum Commands {
         /// Do not delete files, only copy
         #[arg(long, conflicts_with = "delete_extraneous")]
         no_delete: bool,
+        /// How file contents are copied (auto tries reflink, then copy_file_range, then plain copy)
+        #[arg(long, value_enum, default_value_t = CopyMode::Auto)]
+        copy_mode: CopyMode,
+        /// Update changed files with a block-level delta instead of a full recopy
+        #[arg(long, default_value_t = false)]
+        delta: bool,
     },
 }
 
@@ -159,29 +231,99 @@ fn main() {
 fn run() -> Result<ExitStatus> {
     let cli = Cli::parse();
 
-    match cli.command {
-        Some(Commands::Compare { folder1, folder2 }) => run_compare(CompareConfig {
+    if cli.stats {
+        stats::enable();
+    }
+    if cli.drop_cache {
+        cmpf::utils::set_drop_cache(true);
+    }
+    if let Some(mib) = cli.par_hash_threshold {
+        cmpf::utils::set_par_hash_threshold(mib * 1024 * 1024);
+    }
+    if cli.quiet {
+        cmpf::report::set_quiet(true);
+    }
+
+    let status = match cli.command {
+        Some(Commands::Compare {
             folder1,
             folder2,
-            mode: cli.mode,
-            algo: cli.algo,
-            output_folder: cli.output_folder,
-            output_format: cli.output_format,
-            depth: cli.depth,
-            no_recursive: cli.no_recursive,
-            symlinks: cli.symlinks,
-            verbose: cli.verbose,
-            hidden: cli.hidden,
-            types: cli.types,
-            ignore: cli.ignore,
-            threads: cli.threads,
-            no_sort: cli.no_sort,
-            diff_cmd: cli.diff_cmd,
-        }),
-        Some(Commands::Snapshot { folder, output }) => {
+            extra,
+        }) => {
+            // rsync-style remote spec on the second folder hands off to the
+            // digest-exchange path; everything else stays local.
+            if let Some((host, remote_path)) =
+                parse_remote_spec(&folder2.to_string_lossy()).filter(|_| extra.is_empty())
+            {
+                run_remote_compare(RemoteCompareConfig {
+                    folder1,
+                    host,
+                    remote_path,
+                    remote_cmd: cli.remote_cmd,
+                    algo: cli.algo,
+                    output_folder: cli.output_folder,
+                    output_format: cli.output_format,
+                    depth: cli.depth,
+                    no_recursive: cli.no_recursive,
+                    hidden: cli.hidden,
+                    types: cli.types,
+                    ignore: cli.ignore,
+                    symlinks: cli.symlinks,
+                    threads: cli.threads,
+                })
+            } else if extra.is_empty() {
+                run_compare(CompareConfig {
+                    folder1,
+                    folder2,
+                    mode: cli.mode,
+                    algo: cli.algo,
+                    output_folder: cli.output_folder,
+                    output_format: cli.output_format,
+                    depth: cli.depth,
+                    no_recursive: cli.no_recursive,
+                    symlinks: cli.symlinks,
+                    verbose: cli.verbose,
+                    hidden: cli.hidden,
+                    types: cli.types,
+                    ignore: cli.ignore,
+                    threads: cli.threads,
+                    no_sort: cli.no_sort,
+                    diff_cmd: cli.diff_cmd,
+                    cache: cli.cache,
+                    cache_dir: cli.cache_dir,
+                    engine: cli.engine,
+                    hash_sample: cli.hash_sample,
+                    fail_fast: cli.fail_fast,
+                    memory_limit: cli.memory_limit.map(|mib| mib * 1024 * 1024),
+                })
+            } else {
+                let mut folders = vec![folder1, folder2];
+                folders.extend(extra);
+                run_multiway(MultiwayConfig {
+                    folders,
+                    algo: cli.algo,
+                    output_folder: cli.output_folder,
+                    output_format: cli.output_format,
+                    depth: cli.depth,
+                    no_recursive: cli.no_recursive,
+                    hidden: cli.hidden,
+                    types: cli.types,
+                    ignore: cli.ignore,
+                    symlinks: cli.symlinks,
+                    threads: cli.threads,
+                    hash_sample: cli.hash_sample,
+                })
+            }
+        }
+        Some(Commands::Snapshot {
+            folder,
+            output,
+            format,
+        }) => {
             create_snapshot(SnapshotConfig {
                 folder,
                 output,
+                format,
                 algo: cli.algo,
                 depth: cli.depth,
                 no_recursive: cli.no_recursive,
@@ -193,19 +335,91 @@ fn run() -> Result<ExitStatus> {
             })?;
             Ok(ExitStatus::Success)
         }
-        Some(Commands::Verify { folder, snapshot }) => verify_snapshot(VerifyConfig {
+        Some(Commands::DiffSnapshots {
+            snapshot1,
+            snapshot2,
+        }) => diff_snapshots(DiffSnapshotsConfig {
+            snapshot1,
+            snapshot2,
+            output_format: cli.output_format,
+            verbose: cli.verbose,
+        }),
+        Some(Commands::Verify {
+            folder,
+            snapshot,
+            quick,
+        }) => verify_snapshot(VerifyConfig {
             folder,
             snapshot_path: snapshot,
             threads: cli.threads,
             output_format: cli.output_format,
             verbose: cli.verbose,
+            quick,
+            memory_limit: cli.memory_limit.map(|mib| mib * 1024 * 1024),
+        }),
+        Some(Commands::Dedupe { folder }) => run_dedupe(DedupeConfig {
+            folder,
+            algo: cli.algo,
+            output_folder: cli.output_folder,
+            output_format: cli.output_format,
+            depth: cli.depth,
+            no_recursive: cli.no_recursive,
+            hidden: cli.hidden,
+            types: cli.types,
+            ignore: cli.ignore,
+            symlinks: cli.symlinks,
+            threads: cli.threads,
+        }),
+        Some(Commands::Agent { folder }) => run_agent(AgentConfig {
+            folder,
+            algo: cli.algo,
+            depth: cli.depth,
+            no_recursive: cli.no_recursive,
+            hidden: cli.hidden,
+            types: cli.types,
+            ignore: cli.ignore,
+            symlinks: cli.symlinks,
+            threads: cli.threads,
         }),
+        Some(Commands::Watch {
+            folder1,
+            folder2,
+            debounce,
+        }) => run_watch(
+            CompareConfig {
+                folder1,
+                folder2,
+                mode: cli.mode,
+                algo: cli.algo,
+                output_folder: None,
+                output_format: cli.output_format,
+                depth: cli.depth,
+                no_recursive: cli.no_recursive,
+                symlinks: cli.symlinks,
+                verbose: cli.verbose,
+                hidden: cli.hidden,
+                types: cli.types,
+                ignore: cli.ignore,
+                threads: cli.threads,
+                no_sort: cli.no_sort,
+                diff_cmd: cli.diff_cmd,
+                cache: cli.cache,
+                cache_dir: cli.cache_dir,
+                engine: cli.engine,
+                hash_sample: cli.hash_sample,
+                fail_fast: cli.fail_fast,
+                memory_limit: None,
+            },
+            debounce,
+        ),
         Some(Commands::Sync {
             source,
             destination,
             dry_run,
             delete_extraneous,
             no_delete,
+            copy_mode,
+            delta,
         }) => run_sync(SyncConfig {
             source,
             destination,
@@ -220,6 +434,8 @@ fn run() -> Result<ExitStatus> {
             types: cli.types,
             ignore: cli.ignore,
             threads: cli.threads,
+            copy_mode,
+            delta,
         }),
         None => {
             // Default to Compare with legacy args
@@ -241,6 +457,12 @@ fn run() -> Result<ExitStatus> {
                     threads: cli.threads,
                     no_sort: cli.no_sort,
                     diff_cmd: cli.diff_cmd,
+                    cache: cli.cache,
+                    cache_dir: cli.cache_dir,
+                    engine: cli.engine,
+                    hash_sample: cli.hash_sample,
+                    fail_fast: cli.fail_fast,
+                    memory_limit: cli.memory_limit.map(|mib| mib * 1024 * 1024),
                 })
             } else {
                 use clap::CommandFactory;
@@ -249,5 +471,9 @@ fn run() -> Result<ExitStatus> {
                 Ok(ExitStatus::Error)
             }
         }
-    }
+    };
+
+    // After the report so the JSON block is the last thing on stderr.
+    stats::emit();
+    status
 }
@@ -9,6 +9,15 @@ pub enum HashAlgo {
     Sha256,
     Blake3,
     Both,
+    /// Non-cryptographic xxHash3 — runs at memory bandwidth; for trusted
+    /// environments where collision resistance is not a requirement
+    Xxh3,
+    /// Chunked SHA-256 tree hash: fixed-size chunks hashed on all cores,
+    /// then SHA-256 over the chunk digests. Same primitive as sha256 so
+    /// compliance policies that mandate SHA-2 are satisfied, but a 40 GB
+    /// file hashes at aggregate-core speed. NOT comparable with plain
+    /// sha256 digests — the chunking is part of the digest definition.
+    Sha256Tree,
 }
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum, Default)]
@@ -16,6 +25,17 @@ pub enum OutputFormat {
     #[default]
     Txt,
     Json,
+    /// One JSON object per line; consumable while the comparison still runs
+    Ndjson,
+}
+
+/// On-disk format for snapshot files. Binary is the compact, memory-mappable
+/// default; Json remains available as an interchange/export format.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum, Default)]
+pub enum SnapshotFormat {
+    #[default]
+    Binary,
+    Json,
 }
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum, Serialize, Deserialize)]
@@ -24,6 +44,32 @@ pub enum Mode {
     Realtime,
     Batch,
     Metadata,
+    /// Block-wise byte comparison that stops at the first differing block
+    Bytes,
+}
+
+/// Selects the execution engine behind Batch mode.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum, Default)]
+pub enum Engine {
+    /// Walk both folders to completion, then hash common files in parallel
+    #[default]
+    Classic,
+    /// Pipelined walk+hash: hashing starts while the walk is still running
+    Streaming,
+    /// Sorted dual-walk merge-join: O(1) memory per entry, no in-memory maps
+    Merge,
+}
+
+/// Strategy for moving file bytes during sync.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum, Default)]
+pub enum CopyMode {
+    /// Try reflink (FICLONE), then copy_file_range, then a plain copy
+    #[default]
+    Auto,
+    /// Require a reflink clone; fail on filesystems without CoW support
+    Reflink,
+    /// Plain userspace copy (std::fs::copy)
+    Standard,
 }
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq, ValueEnum, Default, Serialize, Deserialize)]
@@ -72,6 +118,205 @@ impl std::fmt::Display for Status {
 pub struct HashResult {
     pub sha256: Option<String>,
     pub blake3: Option<String>,
+    /// Absent in caches/snapshots written before xxh3 support existed.
+    #[serde(default)]
+    pub xxh3: Option<String>,
+    /// True when the digests cover only sampled blocks (--hash-sample), so a
+    /// sampled digest is never confused with a full one.
+    #[serde(default)]
+    pub sampled: bool,
+}
+
+impl HashResult {
+    /// The digest used for identity decisions under the given algorithm.
+    /// For `Both`, BLAKE3 serves as the primary digest.
+    pub fn primary_digest(&self, algo: HashAlgo) -> Option<&str> {
+        match algo {
+            // Tree digests share the sha256 slot; the algo tag keeps them
+            // from ever being compared against plain sha256 digests.
+            HashAlgo::Sha256 | HashAlgo::Sha256Tree => self.sha256.as_deref(),
+            HashAlgo::Blake3 | HashAlgo::Both => self.blake3.as_deref(),
+            HashAlgo::Xxh3 => self.xxh3.as_deref(),
+        }
+    }
+}
+
+/// Interned relative path: a compact index into a [`PathArena`]. Copyable,
+/// 4 bytes, and equality is one integer compare instead of a byte-wise path
+/// comparison — which is what makes it cheap as a hash-map key.
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+pub struct PathId(u32);
+
+/// Path-interning arena: every distinct relative path is stored once in a
+/// single byte buffer and addressed by a [`PathId`] span. The batch engine
+/// sees each rel path up to four times (two map keys, the intersection, the
+/// final result), which at tens of millions of entries made per-path
+/// `PathBuf` clones a dominant allocator load; interning replaces all the
+/// intermediate copies with u32 ids and two big buffers.
+#[derive(Default)]
+pub struct PathArena {
+    bytes: Vec<u8>,
+    spans: Vec<(u32, u32)>,
+    /// Content-hash → candidate ids, so the same rel path interned from both
+    /// sides of the comparison resolves to one id.
+    index: std::collections::HashMap<u64, Vec<PathId>>,
+}
+
+impl PathArena {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    pub fn intern(&mut self, path: &std::path::Path) -> PathId {
+        use std::hash::{Hash, Hasher};
+
+        let bytes = path.as_os_str().as_encoded_bytes();
+        let mut hasher = std::collections::hash_map::DefaultHasher::new();
+        bytes.hash(&mut hasher);
+        let key = hasher.finish();
+
+        if let Some(candidates) = self.index.get(&key) {
+            for &id in candidates {
+                if self.bytes_of(id) == bytes {
+                    return id;
+                }
+            }
+        }
+
+        let offset = self.bytes.len() as u32;
+        self.bytes.extend_from_slice(bytes);
+        let id = PathId(self.spans.len() as u32);
+        self.spans.push((offset, bytes.len() as u32));
+        self.index.entry(key).or_default().push(id);
+        id
+    }
+
+    pub fn get(&self, id: PathId) -> &std::path::Path {
+        // SAFETY: the bytes were produced by `as_encoded_bytes` on an OsStr
+        // and stored verbatim, which is exactly the round-trip contract of
+        // `from_encoded_bytes_unchecked`.
+        std::path::Path::new(unsafe {
+            std::ffi::OsStr::from_encoded_bytes_unchecked(self.bytes_of(id))
+        })
+    }
+
+    pub fn to_path_buf(&self, id: PathId) -> PathBuf {
+        self.get(id).to_path_buf()
+    }
+
+    pub fn len(&self) -> usize {
+        self.spans.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.spans.is_empty()
+    }
+
+    fn bytes_of(&self, id: PathId) -> &[u8] {
+        let (offset, len) = self.spans[id.0 as usize];
+        &self.bytes[offset as usize..(offset + len) as usize]
+    }
+}
+
+/// Merkle-style rollup index: one digest per directory, computed bottom-up as
+/// the BLAKE3 hash of the sorted (child name, child digest) pairs. Two
+/// directories with equal rollups contain byte-identical subtrees, so a
+/// compare engine can prune the whole subtree without touching its files.
+///
+/// Files whose digest is unknown (`None`) taint their entire ancestor chain:
+/// tainted directories get no rollup and are never pruned.
+pub struct DirIndex {
+    dirs: std::collections::BTreeMap<PathBuf, String>,
+}
+
+impl DirIndex {
+    pub fn build<I>(files: I) -> Self
+    where
+        I: IntoIterator<Item = (PathBuf, Option<String>)>,
+    {
+        use std::collections::{BTreeMap, HashSet};
+        use std::path::Path;
+
+        let mut children: BTreeMap<PathBuf, Vec<(String, Option<String>)>> = BTreeMap::new();
+        let mut tainted: HashSet<PathBuf> = HashSet::new();
+
+        for (rel, digest) in files {
+            let parent = rel.parent().unwrap_or(Path::new("")).to_path_buf();
+            let name = rel
+                .file_name()
+                .map(|n| n.to_string_lossy().to_string())
+                .unwrap_or_default();
+
+            if digest.is_none() {
+                let mut d = parent.clone();
+                loop {
+                    tainted.insert(d.clone());
+                    if !d.pop() {
+                        break;
+                    }
+                }
+            }
+
+            // Make sure every ancestor directory has an entry, even ones that
+            // only contain subdirectories.
+            let mut d = parent.clone();
+            loop {
+                children.entry(d.clone()).or_default();
+                if !d.pop() {
+                    break;
+                }
+            }
+
+            children.entry(parent).or_default().push((name, digest));
+        }
+
+        // Roll up deepest-first so a directory's digest is ready before its
+        // parent consumes it.
+        let mut order: Vec<PathBuf> = children.keys().cloned().collect();
+        order.sort_by_key(|d| std::cmp::Reverse(d.components().count()));
+
+        let mut rollups: BTreeMap<PathBuf, String> = BTreeMap::new();
+        for dir in order {
+            if tainted.contains(&dir) {
+                continue;
+            }
+            let mut kids = children.get(&dir).cloned().unwrap_or_default();
+            kids.sort();
+
+            let mut hasher = blake3::Hasher::new();
+            for (name, digest) in kids {
+                let Some(digest) = digest else { continue };
+                hasher.update(name.as_bytes());
+                hasher.update(b"\0");
+                hasher.update(digest.as_bytes());
+                hasher.update(b"\n");
+            }
+            let rollup = hasher.finalize().to_hex().to_string();
+
+            if let Some(parent) = dir.parent() {
+                let dir_name = dir
+                    .file_name()
+                    .map(|n| n.to_string_lossy().to_string())
+                    .unwrap_or_default();
+                children
+                    .entry(parent.to_path_buf())
+                    .or_default()
+                    .push((dir_name, Some(rollup.clone())));
+            }
+            rollups.insert(dir, rollup);
+        }
+
+        DirIndex { dirs: rollups }
+    }
+
+    pub fn rollup(&self, dir: &std::path::Path) -> Option<&str> {
+        self.dirs.get(dir).map(|s| s.as_str())
+    }
+
+    /// Directories in path order (parents before their descendants).
+    pub fn iter(&self) -> impl Iterator<Item = (&PathBuf, &str)> {
+        self.dirs.iter().map(|(d, r)| (d, r.as_str()))
+    }
 }
 
 #[derive(Debug, Clone)]
@@ -80,6 +325,10 @@ pub struct FileEntry {
     pub size: u64,
     pub modified: Option<std::time::SystemTime>,
     pub symlink_target: Option<String>,
+    /// (device, inode) on Unix; None elsewhere. Two entries with the same
+    /// id are hardlinks to the same bytes, so comparing or rehashing them
+    /// is pure waste (common in rsync --link-dest backup trees).
+    pub file_id: Option<(u64, u64)>,
 }
 
 #[derive(Debug, Clone, Serialize)]
@@ -223,7 +472,7 @@ impl ComparisonResult {
     fn format_hashres(&self, h: &HashResult, algo: HashAlgo) -> anyhow::Result<String> {
         use anyhow::Context;
         match algo {
-            HashAlgo::Sha256 => Ok(h
+            HashAlgo::Sha256 | HashAlgo::Sha256Tree => Ok(h
                 .sha256
                 .as_ref()
                 .context("SHA256 hash not computed")?
@@ -235,6 +484,12 @@ impl ComparisonResult {
                 .context("BLAKE3 hash not computed")?
                 .color(Color::Cyan)
                 .to_string()),
+            HashAlgo::Xxh3 => Ok(h
+                .xxh3
+                .as_ref()
+                .context("xxHash3 hash not computed")?
+                .color(Color::Cyan)
+                .to_string()),
             HashAlgo::Both => Ok(format!(
                 "sha256:{}\n            blake3:{}",
                 h.sha256
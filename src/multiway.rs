@@ -0,0 +1,311 @@
+//! N-way comparison engine: verify that three or more replicas of a tree
+//! agree, hashing each file exactly once instead of once per pairwise run.
+//!
+//! This generalises the two-map join in `run_batch`: every folder's walk
+//! interns its rel paths into one shared `PathArena`, producing N maps keyed
+//! by `PathId`. For each path in the union the engine reports either full
+//! agreement, the replicas the path is absent from, or — when contents
+//! differ — which replicas diverge from the majority digest.
+
+use anyhow::Result;
+use colored::*;
+use indicatif::{ProgressBar, ProgressStyle};
+use rayon::prelude::*;
+use serde::Serialize;
+use std::collections::HashMap;
+use std::io::{self, IsTerminal, Write};
+use std::path::PathBuf;
+use std::time::Instant;
+
+use crate::compare::ExitStatus;
+use crate::models::{FileEntry, HashAlgo, OutputFormat, PathArena, PathId, Status, SymlinkMode};
+use crate::report::{open_report_sink, print_error_entry, report_filename};
+use crate::utils::{collect_files, compute_hashes, compute_hashes_sampled};
+
+pub struct MultiwayConfig {
+    /// Three or more replicas; two folders go through the classic engines.
+    pub folders: Vec<PathBuf>,
+    pub algo: HashAlgo,
+    pub output_folder: Option<PathBuf>,
+    pub output_format: OutputFormat,
+    pub depth: Option<usize>,
+    pub no_recursive: bool,
+    pub hidden: bool,
+    pub types: Option<Vec<String>>,
+    pub ignore: Option<Vec<String>>,
+    pub symlinks: SymlinkMode,
+    pub threads: Option<usize>,
+    pub hash_sample: Option<usize>,
+}
+
+/// Per-path verdict across all replicas.
+#[derive(Serialize)]
+struct MultiwayResult {
+    file: PathBuf,
+    status: Status,
+    /// Replicas the path is missing from (status Missing).
+    absent_in: Vec<String>,
+    /// Replicas whose digest disagrees with the majority (status Diff).
+    diverging: Vec<String>,
+}
+
+pub fn run_multiway(config: MultiwayConfig) -> Result<ExitStatus> {
+    let start_time = Instant::now();
+
+    // Fix #5: silently ignore if global pool is already initialised
+    if let Some(num_threads) = config.threads {
+        let _ = rayon::ThreadPoolBuilder::new()
+            .num_threads(num_threads)
+            .build_global();
+    }
+
+    if io::stdout().is_terminal() {
+        println!(
+            "{} ({} folders)",
+            "N-way Comparison".bright_cyan(),
+            config.folders.len()
+        );
+    }
+
+    // All walks in parallel, exactly like run_batch does for its two.
+    let walks: Vec<_> = config
+        .folders
+        .par_iter()
+        .map(|folder| {
+            collect_files(
+                folder,
+                config.depth,
+                config.no_recursive,
+                config.hidden,
+                &config.types,
+                &config.ignore,
+                config.symlinks,
+            )
+        })
+        .collect::<Result<Vec<_>>>()?;
+
+    let mut total_errors = 0;
+    let mut arena = PathArena::new();
+    let mut maps: Vec<HashMap<PathId, FileEntry>> = Vec::with_capacity(walks.len());
+    for ((files, errors), folder) in walks.into_iter().zip(&config.folders) {
+        for e in &errors {
+            print_error_entry(e, &folder.display().to_string());
+        }
+        total_errors += errors.len();
+        maps.push(
+            files
+                .into_iter()
+                .map(|f| (arena.intern(f.path.strip_prefix(folder).unwrap()), f))
+                .collect(),
+        );
+    }
+    let arena = arena;
+
+    let mut union: Vec<PathId> = maps
+        .iter()
+        .flat_map(|m| m.keys().copied())
+        .collect::<std::collections::HashSet<_>>()
+        .into_iter()
+        .collect();
+    // Largest-first, same as run_batch: keeps one straggler core from
+    // holding the run hostage on a giant replica set.
+    union.sort_unstable_by_key(|id| {
+        std::cmp::Reverse(
+            maps.iter()
+                .filter_map(|m| m.get(id))
+                .map(|e| e.size)
+                .max()
+                .unwrap_or(0),
+        )
+    });
+
+    let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+        let pb = ProgressBar::new(union.len() as u64);
+        pb.set_style(
+            ProgressStyle::default_bar()
+                .template("{spinner:.green} Verifying replicas {bar:40.cyan/blue} {pos}/{len}")?,
+        );
+        Some(pb)
+    } else {
+        None
+    };
+
+    let labels: Vec<String> = config
+        .folders
+        .iter()
+        .map(|f| f.display().to_string())
+        .collect();
+
+    let mut results: Vec<MultiwayResult> = union
+        .par_iter()
+        .map(|&id| -> Result<MultiwayResult> {
+            if let Some(ref p) = pb {
+                p.inc(1);
+            }
+            let rel = arena.get(id);
+            let entries: Vec<Option<&FileEntry>> = maps.iter().map(|m| m.get(&id)).collect();
+
+            let absent_in: Vec<String> = entries
+                .iter()
+                .zip(&labels)
+                .filter(|(e, _)| e.is_none())
+                .map(|(_, l)| l.clone())
+                .collect();
+            if !absent_in.is_empty() {
+                return Ok(MultiwayResult {
+                    file: rel.to_path_buf(),
+                    status: Status::Missing,
+                    absent_in,
+                    diverging: Vec::new(),
+                });
+            }
+
+            // Present everywhere: hash each replica's copy exactly once.
+            let digests: Vec<Option<String>> = entries
+                .iter()
+                .map(|e| -> Result<Option<String>> {
+                    let entry = e.unwrap();
+                    let h = match config.hash_sample {
+                        Some(k) => compute_hashes_sampled(&entry.path, config.algo, k)?,
+                        None => compute_hashes(&entry.path, config.algo)?,
+                    };
+                    Ok(h.primary_digest(config.algo).map(str::to_string))
+                })
+                .collect::<Result<Vec<_>>>()?;
+
+            // Majority digest wins; everyone else diverges. On a tie the
+            // first replica's digest is the baseline, which matches how an
+            // operator reads "replica N diverges". (max_by_key would keep
+            // the *last* maximum, so fold with strict > instead.)
+            let mut counts: HashMap<&Option<String>, usize> = HashMap::new();
+            for d in &digests {
+                *counts.entry(d).or_insert(0) += 1;
+            }
+            let majority = digests
+                .iter()
+                .fold((None, 0usize), |(best, best_count), d| {
+                    let count = counts.get(d).copied().unwrap_or(0);
+                    if count > best_count {
+                        (Some(d), count)
+                    } else {
+                        (best, best_count)
+                    }
+                })
+                .0
+                .unwrap()
+                .clone();
+
+            let diverging: Vec<String> = digests
+                .iter()
+                .zip(&labels)
+                .filter(|(d, _)| **d != majority)
+                .map(|(_, l)| l.clone())
+                .collect();
+
+            Ok(MultiwayResult {
+                file: rel.to_path_buf(),
+                status: if diverging.is_empty() {
+                    Status::Match
+                } else {
+                    Status::Diff
+                },
+                absent_in: Vec::new(),
+                diverging,
+            })
+        })
+        .collect::<Result<Vec<_>>>()?;
+
+    if let Some(ref p) = pb {
+        p.finish_with_message("Verification complete");
+    }
+
+    results.sort_by(|a, b| a.file.cmp(&b.file));
+
+    let matches = results.iter().filter(|r| r.status == Status::Match).count();
+    let diffs = results.iter().filter(|r| r.status == Status::Diff).count();
+    let missing = results
+        .iter()
+        .filter(|r| r.status == Status::Missing)
+        .count();
+
+    let (mut sink, report_path) = open_report_sink(
+        &config.output_folder,
+        report_filename(config.output_format),
+    )?;
+    match config.output_format {
+        OutputFormat::Txt => {
+            for r in &results {
+                match r.status {
+                    Status::Match => continue,
+                    Status::Missing => writeln!(
+                        sink,
+                        "[{}]  {} (absent in: {})",
+                        "MISSING".blue(),
+                        r.file.display(),
+                        r.absent_in.join(", ")
+                    )?,
+                    _ => writeln!(
+                        sink,
+                        "[{}]  {} (diverges: {})",
+                        "DIFF".red(),
+                        r.file.display(),
+                        r.diverging.join(", ")
+                    )?,
+                }
+            }
+            writeln!(sink)?;
+            writeln!(
+                sink,
+                "{} paths across {} replicas: {} agree, {} diverge, {} incomplete ({:.2?})",
+                results.len(),
+                config.folders.len(),
+                matches,
+                diffs,
+                missing,
+                start_time.elapsed()
+            )?;
+        }
+        OutputFormat::Json => {
+            let doc = serde_json::json!({
+                "summary": {
+                    "folders": labels,
+                    "total": results.len(),
+                    "matches": matches,
+                    "diverging": diffs,
+                    "incomplete": missing,
+                    "errors": total_errors,
+                    "time_taken": format!("{:.2?}", start_time.elapsed()),
+                },
+                "results": results,
+            });
+            serde_json::to_writer(&mut *sink, &doc)?;
+            writeln!(sink)?;
+        }
+        OutputFormat::Ndjson => {
+            for r in &results {
+                serde_json::to_writer(&mut *sink, r)?;
+                writeln!(sink)?;
+            }
+            serde_json::to_writer(
+                &mut *sink,
+                &serde_json::json!({"summary": {
+                    "total": results.len(),
+                    "matches": matches,
+                    "diverging": diffs,
+                    "incomplete": missing,
+                    "errors": total_errors,
+                }}),
+            )?;
+            writeln!(sink)?;
+        }
+    }
+    crate::report::finish_report_sink(sink, report_path)?;
+
+    if total_errors > 0 {
+        Ok(ExitStatus::Error)
+    } else if diffs > 0 || missing > 0 {
+        Ok(ExitStatus::Diff)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
@@ -5,10 +5,27 @@ use std::io::{self, IsTerminal, Write};
 use std::path::{Path, PathBuf};
 use std::time::Duration;
 
-use crate::models::{ComparisonResult, ErrorEntry, HashAlgo, Mode, Status};
+use crate::models::{ComparisonResult, ErrorEntry, HashAlgo, Mode, OutputFormat, Status};
+
+/// With --quiet set, per-file output (realtime result lines, progress
+/// bars) is suppressed and only reports, summaries and errors remain.
+/// Process-wide like the stats switch: per-file hot loops pay one relaxed
+/// load instead of every call site threading a flag through the configs.
+static QUIET: std::sync::atomic::AtomicBool = std::sync::atomic::AtomicBool::new(false);
+
+pub fn set_quiet(enabled: bool) {
+    QUIET.store(enabled, std::sync::atomic::Ordering::Relaxed);
+}
+
+pub fn quiet() -> bool {
+    QUIET.load(std::sync::atomic::Ordering::Relaxed)
+}
 
 // Fix #8: print_realtime_missing now takes a Status enum instead of &str
 pub fn print_realtime_missing(status: Status, file: &Path, _verbose: bool) -> Result<()> {
+    if quiet() {
+        return Ok(());
+    }
     let (status_colored, file_color) = match status {
         Status::Missing => ("MISSING".blue(), Color::Blue),
         Status::Extra => ("EXTRA".blue(), Color::Blue),
@@ -51,10 +68,10 @@ pub struct SummaryData {
 
 pub fn generate_summary_text(data: &SummaryData, config: &ReportConfig) -> Vec<String> {
     let mode_str = format!("{:?}", config.mode);
-    let algo_str = if config.mode == Mode::Metadata {
-        "Metadata".to_string()
-    } else {
-        format!("{:?}", config.algo)
+    let algo_str = match config.mode {
+        Mode::Metadata => "Metadata".to_string(),
+        Mode::Bytes => "Bytes".to_string(),
+        _ => format!("{:?}", config.algo),
     };
     let threads_str = if let Some(t) = config.threads {
         t.to_string()
@@ -191,51 +208,88 @@ pub fn generate_summary_text(data: &SummaryData, config: &ReportConfig) -> Vec<S
     output
 }
 
-pub fn generate_text_report(
+/// Report file name for a given output format.
+pub fn report_filename(format: OutputFormat) -> &'static str {
+    match format {
+        OutputFormat::Txt => "report.txt",
+        OutputFormat::Json => "report.json",
+        OutputFormat::Ndjson => "report.ndjson",
+    }
+}
+
+/// Open the report sink: a BufWriter over `filename` inside `output_folder`,
+/// or stdout when no folder was given. The returned path is Some only in the
+/// file case so callers can announce where the report landed.
+///
+/// Everything downstream writes through this sink entry by entry — the full
+/// report is never materialised as one String, which used to cost gigabytes
+/// transiently on many-million-file runs and delayed first output to the end.
+pub fn open_report_sink(
+    output_folder: &Option<PathBuf>,
+    filename: &str,
+) -> Result<(Box<dyn Write>, Option<PathBuf>)> {
+    if let Some(folder) = output_folder {
+        fs::create_dir_all(folder)?;
+        let path = folder.join(filename);
+        let file = File::create(&path)?;
+        Ok((Box::new(io::BufWriter::new(file)), Some(path)))
+    } else {
+        Ok((Box::new(io::BufWriter::new(io::stdout())), None))
+    }
+}
+
+/// Flush the sink and, when it was a file, tell an interactive user where
+/// the report went.
+pub fn finish_report_sink(mut sink: Box<dyn Write>, path: Option<PathBuf>) -> Result<()> {
+    sink.flush()?;
+    if let Some(path) = path
+        && io::stdout().is_terminal()
+    {
+        println!("Report saved to {}", path.display());
+    }
+    Ok(())
+}
+
+pub fn write_text_report(
+    sink: &mut dyn Write,
     results: &[ComparisonResult],
     errors1: &[ErrorEntry],
     errors2: &[ErrorEntry],
     summary_data: &SummaryData,
     config: &ReportConfig,
-) -> Result<String> {
-    let mut output = String::new();
-
+) -> Result<()> {
     for e in errors1 {
-        output.push_str(&format!(
-            "[{}] {} (folder1: {})\n",
+        writeln!(
+            sink,
+            "[{}] {} (folder1: {})",
             "ERROR".red().on_white(),
             e.path.display(),
             e.error
-        ));
+        )?;
     }
     for e in errors2 {
-        output.push_str(&format!(
-            "[{}] {} (folder2: {})\n",
+        writeln!(
+            sink,
+            "[{}] {} (folder2: {})",
             "ERROR".red().on_white(),
             e.path.display(),
             e.error
-        ));
+        )?;
     }
 
     for result in results {
-        output.push_str(&result.format_text(config.verbose, config.algo)?);
+        sink.write_all(result.format_text(config.verbose, config.algo)?.as_bytes())?;
     }
 
-    output.push('\n');
-
-    let summary_text = generate_summary_text(summary_data, config);
-    output.push_str(&summary_text.join("\n"));
-
-    Ok(output)
+    writeln!(sink)?;
+    for line in generate_summary_text(summary_data, config) {
+        writeln!(sink, "{}", line)?;
+    }
+    Ok(())
 }
 
-pub fn generate_json_report(
-    results: &[ComparisonResult],
-    errors1: &[ErrorEntry],
-    errors2: &[ErrorEntry],
-    summary_data: &SummaryData,
-) -> Result<String> {
-    let summary = serde_json::json!({
+fn summary_json(summary_data: &SummaryData) -> serde_json::Value {
+    serde_json::json!({
         "total_files_checked": summary_data.total,
         "matches": summary_data.matches,
         "differences": summary_data.diffs,
@@ -243,31 +297,76 @@ pub fn generate_json_report(
         "extra_in_folder2": summary_data.extra,
         "errors": summary_data.errors,
         "time_taken": format!("{:.2?}", summary_data.elapsed),
-    });
-
-    let output = serde_json::json!({
-        "summary": summary,
-        "folder1_errors": errors1,
-        "folder2_errors": errors2,
-        "results": results,
-    });
-
-    Ok(serde_json::to_string_pretty(&output)?)
+    })
 }
 
-pub fn write_report(output: String, output_folder: &Option<PathBuf>, filename: &str) -> Result<()> {
-    if let Some(output_folder) = output_folder {
-        fs::create_dir_all(output_folder)?;
-        let report_path = output_folder.join(filename);
-        let mut file = File::create(&report_path)?;
-        file.write_all(output.as_bytes())?;
-        if io::stdout().is_terminal() {
-            println!("Report saved to {}", report_path.display());
+/// Same document shape as the old in-memory JSON report, but the results
+/// array is serialised entry by entry instead of via one huge Value tree.
+pub fn write_json_report(
+    sink: &mut dyn Write,
+    results: &[ComparisonResult],
+    errors1: &[ErrorEntry],
+    errors2: &[ErrorEntry],
+    summary_data: &SummaryData,
+) -> Result<()> {
+    write!(sink, "{{\"summary\":")?;
+    serde_json::to_writer(&mut *sink, &summary_json(summary_data))?;
+    write!(sink, ",\"folder1_errors\":")?;
+    serde_json::to_writer(&mut *sink, errors1)?;
+    write!(sink, ",\"folder2_errors\":")?;
+    serde_json::to_writer(&mut *sink, errors2)?;
+    write!(sink, ",\"results\":[")?;
+    for (i, result) in results.iter().enumerate() {
+        if i > 0 {
+            write!(sink, ",")?;
         }
-    } else {
-        for line in output.lines() {
-            println!("{}", line);
+        serde_json::to_writer(&mut *sink, result)?;
+    }
+    writeln!(sink, "]}}")?;
+    Ok(())
+}
+
+/// One comparison result per line; errors and the trailing summary are
+/// wrapped in `{"error": ...}` / `{"summary": ...}` objects so line-oriented
+/// consumers can tell the record kinds apart without buffering anything.
+pub fn write_ndjson_report(
+    sink: &mut dyn Write,
+    results: &[ComparisonResult],
+    errors1: &[ErrorEntry],
+    errors2: &[ErrorEntry],
+    summary_data: &SummaryData,
+) -> Result<()> {
+    for (source, errors) in [("folder1", errors1), ("folder2", errors2)] {
+        for e in errors {
+            write_ndjson_error(sink, e, source)?;
         }
     }
+    for result in results {
+        write_ndjson_result(sink, result)?;
+    }
+    write_ndjson_summary(sink, summary_data)
+}
+
+pub fn write_ndjson_result(sink: &mut dyn Write, result: &ComparisonResult) -> Result<()> {
+    serde_json::to_writer(&mut *sink, result)?;
+    writeln!(sink)?;
+    Ok(())
+}
+
+pub fn write_ndjson_error(sink: &mut dyn Write, e: &ErrorEntry, source: &str) -> Result<()> {
+    serde_json::to_writer(
+        &mut *sink,
+        &serde_json::json!({"error": e, "source": source}),
+    )?;
+    writeln!(sink)?;
+    Ok(())
+}
+
+pub fn write_ndjson_summary(sink: &mut dyn Write, summary_data: &SummaryData) -> Result<()> {
+    serde_json::to_writer(
+        &mut *sink,
+        &serde_json::json!({"summary": summary_json(summary_data)}),
+    )?;
+    writeln!(sink)?;
     Ok(())
 }
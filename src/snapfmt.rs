@@ -0,0 +1,356 @@
+//! Compact binary snapshot format.
+//!
+//! Layout (all integers little-endian):
+//!
+//! ```text
+//! magic            8 bytes  "CMPFSNAP"
+//! version          u32      (2 adds the xxh3 digest slot per record)
+//! algo             u8       (0 = sha256, 1 = blake3, 2 = both, 3 = xxh3, 4 = sha256-tree)
+//! created_at       u32 len + bytes (RFC 3339)
+//! root_path        u32 len + bytes
+//! scan_params      u32 len + bytes (JSON; 0 = absent)
+//! entry_count      u64      (patched in place by finish())
+//! entries          variable-length records, see write_entry()
+//! ```
+//!
+//! Records are written streamingly — the only back-patch is the entry count —
+//! and the reader walks them straight out of an `Mmap`, so opening a snapshot
+//! costs milliseconds regardless of size and nothing is parsed into an
+//! intermediate DOM the way serde_json::from_reader does.
+
+use anyhow::{Context, Result, bail};
+use memmap2::Mmap;
+use std::fs::File;
+use std::io::{BufWriter, Read, Seek, SeekFrom, Write};
+use std::path::{Path, PathBuf};
+use std::time::{Duration, UNIX_EPOCH};
+
+use crate::models::{HashAlgo, HashResult};
+use crate::snapshot::{SnapshotEntry, SnapshotScanParams};
+
+pub const SNAPSHOT_MAGIC: &[u8; 8] = b"CMPFSNAP";
+const SNAPSHOT_VERSION: u32 = 2;
+
+/// Sniff the magic bytes so `verify` can accept both formats transparently.
+pub fn is_binary_snapshot(path: &Path) -> bool {
+    let mut buf = [0u8; 8];
+    match File::open(path).and_then(|mut f| f.read_exact(&mut buf)) {
+        Ok(()) => &buf == SNAPSHOT_MAGIC,
+        Err(_) => false,
+    }
+}
+
+fn algo_to_byte(algo: HashAlgo) -> u8 {
+    match algo {
+        HashAlgo::Sha256 => 0,
+        HashAlgo::Blake3 => 1,
+        HashAlgo::Both => 2,
+        HashAlgo::Xxh3 => 3,
+        HashAlgo::Sha256Tree => 4,
+    }
+}
+
+fn algo_from_byte(b: u8) -> Result<HashAlgo> {
+    Ok(match b {
+        0 => HashAlgo::Sha256,
+        1 => HashAlgo::Blake3,
+        2 => HashAlgo::Both,
+        3 => HashAlgo::Xxh3,
+        4 => HashAlgo::Sha256Tree,
+        other => bail!("Unknown hash algorithm tag in snapshot: {}", other),
+    })
+}
+
+fn hex_to_digest(hex: &str) -> Result<[u8; 32]> {
+    let mut out = [0u8; 32];
+    if hex.len() != 64 {
+        bail!("Unexpected digest length: {}", hex.len());
+    }
+    for (i, byte) in out.iter_mut().enumerate() {
+        *byte = u8::from_str_radix(&hex[i * 2..i * 2 + 2], 16)
+            .context("Invalid hex digit in digest")?;
+    }
+    Ok(out)
+}
+
+fn digest_to_hex(bytes: &[u8]) -> String {
+    use std::fmt::Write as FmtWrite;
+    let mut s = String::with_capacity(bytes.len() * 2);
+    for b in bytes {
+        write!(s, "{:02x}", b).expect("write to String is infallible");
+    }
+    s
+}
+
+pub struct BinarySnapshotWriter {
+    out: BufWriter<File>,
+    count: u64,
+    count_pos: u64,
+}
+
+impl BinarySnapshotWriter {
+    pub fn create(
+        path: &Path,
+        algo: HashAlgo,
+        created_at: &str,
+        root_path: &str,
+        scan_params: Option<&SnapshotScanParams>,
+    ) -> Result<Self> {
+        let file = File::create(path)
+            .with_context(|| format!("Cannot create snapshot file {}", path.display()))?;
+        let mut out = BufWriter::new(file);
+
+        out.write_all(SNAPSHOT_MAGIC)?;
+        out.write_all(&SNAPSHOT_VERSION.to_le_bytes())?;
+        out.write_all(&[algo_to_byte(algo)])?;
+        write_blob(&mut out, created_at.as_bytes())?;
+        write_blob(&mut out, root_path.as_bytes())?;
+        let params_json = match scan_params {
+            Some(p) => serde_json::to_string(p)?,
+            None => String::new(),
+        };
+        write_blob(&mut out, params_json.as_bytes())?;
+
+        let count_pos = out.stream_position()?;
+        out.write_all(&0u64.to_le_bytes())?; // entry_count placeholder
+
+        Ok(BinarySnapshotWriter {
+            out,
+            count: 0,
+            count_pos,
+        })
+    }
+
+    pub fn write_entry(&mut self, entry: &SnapshotEntry) -> Result<()> {
+        let path_str = entry.rel_path.to_string_lossy();
+        write_blob(&mut self.out, path_str.as_bytes())?;
+        self.out.write_all(&entry.size.to_le_bytes())?;
+
+        match entry
+            .modified
+            .and_then(|m| m.duration_since(UNIX_EPOCH).ok())
+        {
+            Some(d) => {
+                self.out.write_all(&[1])?;
+                self.out.write_all(&d.as_secs().to_le_bytes())?;
+                self.out.write_all(&d.subsec_nanos().to_le_bytes())?;
+            }
+            None => self.out.write_all(&[0])?,
+        }
+
+        for hex in [&entry.hashes.sha256, &entry.hashes.blake3] {
+            match hex {
+                Some(h) => {
+                    self.out.write_all(&[1])?;
+                    self.out.write_all(&hex_to_digest(h)?)?;
+                }
+                None => self.out.write_all(&[0])?,
+            }
+        }
+
+        match &entry.hashes.xxh3 {
+            Some(h) => {
+                self.out.write_all(&[1])?;
+                let v = u64::from_str_radix(h, 16)
+                    .map_err(|_| anyhow::anyhow!("Invalid xxh3 digest: {}", h))?;
+                self.out.write_all(&v.to_le_bytes())?;
+            }
+            None => self.out.write_all(&[0])?,
+        }
+
+        match &entry.symlink_target {
+            Some(target) => write_blob(&mut self.out, target.as_bytes())?,
+            None => write_blob(&mut self.out, &[])?,
+        }
+
+        self.count += 1;
+        Ok(())
+    }
+
+    /// Patch the entry count into the header and flush. Returns the number of
+    /// entries written.
+    pub fn finish(mut self) -> Result<u64> {
+        self.out.flush()?;
+        let file = self.out.get_mut();
+        file.seek(SeekFrom::Start(self.count_pos))?;
+        file.write_all(&self.count.to_le_bytes())?;
+        file.flush()?;
+        Ok(self.count)
+    }
+}
+
+fn write_blob<W: Write>(out: &mut W, bytes: &[u8]) -> Result<()> {
+    out.write_all(&(bytes.len() as u32).to_le_bytes())?;
+    out.write_all(bytes)?;
+    Ok(())
+}
+
+pub struct BinarySnapshotReader {
+    mmap: Mmap,
+    version: u32,
+    pub algo: HashAlgo,
+    pub created_at: String,
+    pub root_path: String,
+    pub scan_params: Option<SnapshotScanParams>,
+    pub entry_count: u64,
+    entries_offset: usize,
+}
+
+impl BinarySnapshotReader {
+    pub fn open(path: &Path) -> Result<Self> {
+        let file = File::open(path)
+            .with_context(|| format!("Cannot open snapshot file {}", path.display()))?;
+        let mmap = unsafe { Mmap::map(&file)? };
+        let mut cursor = Cursor {
+            data: &mmap,
+            pos: 0,
+        };
+
+        if cursor.take(8)? != SNAPSHOT_MAGIC {
+            bail!("Not a binary cmpf snapshot (bad magic)");
+        }
+        let version = cursor.read_u32()?;
+        if !(1..=SNAPSHOT_VERSION).contains(&version) {
+            bail!("Unsupported snapshot version: {}", version);
+        }
+        let algo = algo_from_byte(cursor.read_u8()?)?;
+        let created_at = String::from_utf8_lossy(cursor.read_blob()?).to_string();
+        let root_path = String::from_utf8_lossy(cursor.read_blob()?).to_string();
+        let params_blob = cursor.read_blob()?;
+        let scan_params = if params_blob.is_empty() {
+            None
+        } else {
+            Some(serde_json::from_slice(params_blob).context("Corrupt scan parameters")?)
+        };
+        let entry_count = cursor.read_u64()?;
+        let entries_offset = cursor.pos;
+
+        Ok(BinarySnapshotReader {
+            mmap,
+            version,
+            algo,
+            created_at,
+            root_path,
+            scan_params,
+            entry_count,
+            entries_offset,
+        })
+    }
+
+    /// Iterate the records straight out of the mapping; entries materialise
+    /// one at a time, never the whole file.
+    pub fn entries(&self) -> EntryIter<'_> {
+        EntryIter {
+            cursor: Cursor {
+                data: &self.mmap,
+                pos: self.entries_offset,
+            },
+            remaining: self.entry_count,
+            version: self.version,
+        }
+    }
+}
+
+pub struct EntryIter<'a> {
+    cursor: Cursor<'a>,
+    remaining: u64,
+    version: u32,
+}
+
+impl Iterator for EntryIter<'_> {
+    type Item = Result<SnapshotEntry>;
+
+    fn next(&mut self) -> Option<Self::Item> {
+        if self.remaining == 0 {
+            return None;
+        }
+        self.remaining -= 1;
+        Some(self.cursor.read_entry(self.version))
+    }
+}
+
+struct Cursor<'a> {
+    data: &'a [u8],
+    pos: usize,
+}
+
+impl<'a> Cursor<'a> {
+    fn take(&mut self, n: usize) -> Result<&'a [u8]> {
+        let end = self
+            .pos
+            .checked_add(n)
+            .filter(|&e| e <= self.data.len())
+            .context("Truncated snapshot file")?;
+        let slice = &self.data[self.pos..end];
+        self.pos = end;
+        Ok(slice)
+    }
+
+    fn read_u8(&mut self) -> Result<u8> {
+        Ok(self.take(1)?[0])
+    }
+
+    fn read_u32(&mut self) -> Result<u32> {
+        Ok(u32::from_le_bytes(self.take(4)?.try_into().unwrap()))
+    }
+
+    fn read_u64(&mut self) -> Result<u64> {
+        Ok(u64::from_le_bytes(self.take(8)?.try_into().unwrap()))
+    }
+
+    fn read_blob(&mut self) -> Result<&'a [u8]> {
+        let len = self.read_u32()? as usize;
+        self.take(len)
+    }
+
+    fn read_entry(&mut self, version: u32) -> Result<SnapshotEntry> {
+        let rel_path = PathBuf::from(String::from_utf8_lossy(self.read_blob()?).to_string());
+        let size = self.read_u64()?;
+
+        let modified = if self.read_u8()? == 1 {
+            let secs = self.read_u64()?;
+            let nanos = self.read_u32()?;
+            Some(UNIX_EPOCH + Duration::new(secs, nanos))
+        } else {
+            None
+        };
+
+        let sha256 = if self.read_u8()? == 1 {
+            Some(digest_to_hex(self.take(32)?))
+        } else {
+            None
+        };
+        let blake3 = if self.read_u8()? == 1 {
+            Some(digest_to_hex(self.take(32)?))
+        } else {
+            None
+        };
+
+        // Version 1 predates xxh3 support and has no slot for it.
+        let xxh3 = if version >= 2 && self.read_u8()? == 1 {
+            Some(format!("{:016x}", self.read_u64()?))
+        } else {
+            None
+        };
+
+        let symlink_blob = self.read_blob()?;
+        let symlink_target = if symlink_blob.is_empty() {
+            None
+        } else {
+            Some(String::from_utf8_lossy(symlink_blob).to_string())
+        };
+
+        Ok(SnapshotEntry {
+            rel_path,
+            size,
+            modified,
+            hashes: HashResult {
+                sha256,
+                blake3,
+                xxh3,
+                sampled: false,
+            },
+            symlink_target,
+        })
+    }
+}
@@ -4,17 +4,25 @@ use indicatif::{ProgressBar, ProgressStyle};
 use rayon::prelude::*;
 use serde::{Deserialize, Serialize};
 use std::collections::HashMap;
-use std::fs::File;
+use std::fs::{self, File};
 use std::io::{self, IsTerminal, Write};
 use std::path::PathBuf;
 use std::time::Instant;
 
 use crate::compare::ExitStatus;
 use crate::models::{
-    ComparisonResult, FileEntry, HashAlgo, HashResult, Mode, OutputFormat, Status, SymlinkMode,
+    ComparisonResult, ErrorEntry, FileEntry, HashAlgo, HashResult, Mode, OutputFormat,
+    SnapshotFormat, Status,
+    SymlinkMode,
 };
-use crate::report::{ReportConfig, SummaryData, generate_json_report, generate_text_report};
-use crate::utils::{collect_files, compute_hashes};
+use crate::snapfmt::{BinarySnapshotReader, BinarySnapshotWriter, is_binary_snapshot};
+use crate::extsort::ExternalSorter;
+use crate::report::{
+    ReportConfig, SummaryData, generate_summary_text, open_report_sink, report_filename,
+    write_json_report, write_ndjson_error, write_ndjson_report, write_ndjson_result,
+    write_ndjson_summary, write_text_report,
+};
+use crate::utils::{WALK_CHANNEL_CAP, collect_files, compute_hashes, stream_files};
 
 // Fix #6: store the scan parameters alongside the snapshot data so that
 // verify_snapshot can reproduce the exact same walk instead of hardcoding
@@ -61,6 +69,7 @@ pub struct SnapshotConfig {
     pub ignore: Option<Vec<String>>,
     pub symlinks: SymlinkMode,
     pub threads: Option<usize>,
+    pub format: SnapshotFormat,
 }
 
 pub fn create_snapshot(config: SnapshotConfig) -> Result<()> {
@@ -75,58 +84,6 @@ pub fn create_snapshot(config: SnapshotConfig) -> Result<()> {
         println!("{}", "Creating Snapshot...".bright_cyan());
     }
 
-    let (files, errors) = collect_files(
-        &config.folder,
-        config.depth,
-        config.no_recursive,
-        config.hidden,
-        &config.types,
-        &config.ignore,
-        config.symlinks,
-    )?;
-
-    for e in &errors {
-        eprintln!("[{}] {}", "ERROR".red(), e.error);
-    }
-
-    let pb = if io::stderr().is_terminal() {
-        let pb = ProgressBar::new(files.len() as u64);
-        pb.set_style(ProgressStyle::default_bar().template(
-            "{spinner:.green} [{elapsed_precise}] {bar:40.cyan/blue} {pos}/{len} ({eta})",
-        )?);
-        Some(pb)
-    } else {
-        None
-    };
-
-    let entries: Vec<SnapshotEntry> = files
-        .par_iter()
-        .map(|f| {
-            if let Some(ref p) = pb {
-                p.inc(1);
-            }
-            // Fix #10: surface hash errors instead of silently storing None hashes.
-            // We propagate the error so the snapshot is not saved with corrupt data.
-            let h = compute_hashes(&f.path, config.algo)?;
-            let rel = f
-                .path
-                .strip_prefix(&config.folder)
-                .unwrap_or(&f.path)
-                .to_path_buf();
-            Ok(SnapshotEntry {
-                rel_path: rel,
-                size: f.size,
-                modified: f.modified,
-                hashes: h,
-                symlink_target: f.symlink_target.clone(),
-            })
-        })
-        .collect::<Result<Vec<_>>>()?;
-
-    if let Some(ref p) = pb {
-        p.finish_with_message("Snapshot complete");
-    }
-
     // Fix #6: persist scan parameters so verify can reproduce the same walk.
     let scan_params = SnapshotScanParams {
         depth: config.depth,
@@ -137,33 +94,223 @@ pub fn create_snapshot(config: SnapshotConfig) -> Result<()> {
         symlinks: config.symlinks,
     };
 
-    let snapshot = Snapshot {
-        created_at: chrono::Local::now().to_rfc3339(),
-        root_path: config.folder.to_string_lossy().to_string(),
-        files: entries,
-        algo: config.algo,
-        scan_params: Some(scan_params),
-    };
+    let created_at = chrono::Local::now().to_rfc3339();
+    let root_path = config.folder.to_string_lossy().to_string();
+
+    match config.format {
+        SnapshotFormat::Binary => {
+            // Fully streaming pipeline: walker → hash workers → writer
+            // thread, all through bounded channels. Peak memory is a couple
+            // of channel buffers regardless of tree size; no Vec of entries
+            // (each carrying digest strings and a PathBuf) is ever built.
+            let out_path = config
+                .output
+                .clone()
+                .unwrap_or_else(|| PathBuf::from("snapshot.cmpf"));
+            // Write to a temp file and rename only on success (same as the
+            // cache save), so an aborted run never clobbers the destination
+            // with a truncated but structurally valid snapshot.
+            let tmp_path = {
+                let mut p = out_path.clone().into_os_string();
+                p.push(".tmp");
+                PathBuf::from(p)
+            };
+            let mut writer = BinarySnapshotWriter::create(
+                &tmp_path,
+                config.algo,
+                &created_at,
+                &root_path,
+                Some(&scan_params),
+            )?;
+
+            let (file_tx, file_rx) = std::sync::mpsc::sync_channel(WALK_CHANNEL_CAP);
+            let (err_tx, err_rx) = std::sync::mpsc::channel();
+            stream_files(
+                &config.folder,
+                config.depth,
+                config.no_recursive,
+                config.hidden,
+                &config.types,
+                &config.ignore,
+                config.symlinks,
+                file_tx,
+                err_tx,
+            )?;
+
+            let (entry_tx, entry_rx) =
+                std::sync::mpsc::sync_channel::<SnapshotEntry>(WALK_CHANNEL_CAP);
+            let writer_handle = std::thread::spawn(move || -> Result<u64> {
+                for entry in entry_rx {
+                    writer.write_entry(&entry)?;
+                }
+                writer.finish()
+            });
+
+            // Entry count is unknown while the walk runs, so show a counter.
+            let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+                let pb = ProgressBar::new_spinner();
+                pb.set_style(ProgressStyle::default_spinner().template(
+                    "{spinner:.green} [{elapsed_precise}] {pos} files snapshotted",
+                )?);
+                Some(pb)
+            } else {
+                None
+            };
+            let progress = crate::utils::BatchedProgress::new(pb, 64);
+
+            let hashed = file_rx
+                .into_iter()
+                .par_bridge()
+                .try_for_each(|f| -> Result<()> {
+                    // Fix #10: propagate hash errors so the snapshot is not
+                    // saved with corrupt data.
+                    let h = compute_hashes(&f.path, config.algo)?;
+                    let rel = f
+                        .path
+                        .strip_prefix(&config.folder)
+                        .unwrap_or(&f.path)
+                        .to_path_buf();
+                    entry_tx
+                        .send(SnapshotEntry {
+                            rel_path: rel,
+                            size: f.size,
+                            modified: f.modified,
+                            hashes: h,
+                            symlink_target: f.symlink_target,
+                        })
+                        .map_err(|_| anyhow::anyhow!("snapshot writer thread terminated"))?;
+                    progress.add(1);
+                    Ok(())
+                });
+            drop(entry_tx);
+
+            // Join the writer even when hashing failed: it back-patches a
+            // valid entry count on the partial file, which must then be
+            // deleted, not left looking like a complete snapshot.
+            let written = writer_handle
+                .join()
+                .map_err(|_| anyhow::anyhow!("snapshot writer thread panicked"))?;
+            let count = match hashed.and(written) {
+                Ok(count) => count,
+                Err(e) => {
+                    let _ = fs::remove_file(&tmp_path);
+                    return Err(e);
+                }
+            };
+            fs::rename(&tmp_path, &out_path)?;
+
+            for e in err_rx {
+                eprintln!("[{}] {}", "ERROR".red(), e.error);
+            }
 
-    let json = serde_json::to_string_pretty(&snapshot)?;
+            progress.finish("Snapshot complete");
+            println!("Snapshot saved to {} ({} entries)", out_path.display(), count);
+        }
+        SnapshotFormat::Json => {
+            // JSON stays an in-memory export path: the whole snapshot is
+            // still collected and pretty-printed, as before.
+            let (files, errors) = collect_files(
+                &config.folder,
+                config.depth,
+                config.no_recursive,
+                config.hidden,
+                &config.types,
+                &config.ignore,
+                config.symlinks,
+            )?;
+
+            for e in &errors {
+                eprintln!("[{}] {}", "ERROR".red(), e.error);
+            }
 
-    if let Some(out_path) = config.output {
-        let mut f = File::create(&out_path)?;
-        f.write_all(json.as_bytes())?;
-        println!("Snapshot saved to {}", out_path.display());
-    } else {
-        println!("{}", json);
+            // Weight the bar by bytes so the ETA holds up when a few large
+            // files dominate the tree.
+            let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+                let total_bytes: u64 = files.iter().map(|f| f.size.max(1)).sum();
+                let pb = ProgressBar::new(total_bytes);
+                pb.set_style(ProgressStyle::default_bar().template(
+                    "{spinner:.green} [{elapsed_precise}] {bar:40.cyan/blue} {bytes}/{total_bytes} ({eta})",
+                )?);
+                Some(pb)
+            } else {
+                None
+            };
+            let progress = crate::utils::BatchedProgress::new(pb, 4 << 20);
+
+            let entries: Vec<SnapshotEntry> = files
+                .par_iter()
+                .map(|f| {
+                    progress.add(f.size.max(1));
+                    // Fix #10: surface hash errors instead of silently storing None hashes.
+                    let h = compute_hashes(&f.path, config.algo)?;
+                    let rel = f
+                        .path
+                        .strip_prefix(&config.folder)
+                        .unwrap_or(&f.path)
+                        .to_path_buf();
+                    Ok(SnapshotEntry {
+                        rel_path: rel,
+                        size: f.size,
+                        modified: f.modified,
+                        hashes: h,
+                        symlink_target: f.symlink_target.clone(),
+                    })
+                })
+                .collect::<Result<Vec<_>>>()?;
+
+            progress.finish("Snapshot complete");
+            let snapshot = Snapshot {
+                created_at,
+                root_path,
+                files: entries,
+                algo: config.algo,
+                scan_params: Some(scan_params),
+            };
+
+            let json = serde_json::to_string_pretty(&snapshot)?;
+
+            if let Some(out_path) = config.output {
+                let mut f = File::create(&out_path)?;
+                f.write_all(json.as_bytes())?;
+                println!("Snapshot saved to {}", out_path.display());
+            } else {
+                println!("{}", json);
+            }
+        }
     }
 
     Ok(())
 }
 
+/// Open a snapshot in either format, sniffing the magic bytes. JSON snapshots
+/// from older versions keep working unchanged.
+pub fn load_snapshot(path: &PathBuf) -> Result<Snapshot> {
+    if is_binary_snapshot(path) {
+        let reader = BinarySnapshotReader::open(path)?;
+        let files = reader.entries().collect::<Result<Vec<_>>>()?;
+        Ok(Snapshot {
+            created_at: reader.created_at,
+            root_path: reader.root_path,
+            files,
+            algo: reader.algo,
+            scan_params: reader.scan_params,
+        })
+    } else {
+        let snapshot_file = File::open(path)?;
+        Ok(serde_json::from_reader(snapshot_file)?)
+    }
+}
+
 pub struct VerifyConfig {
     pub folder: PathBuf,
     pub snapshot_path: PathBuf,
     pub threads: Option<usize>,
     pub output_format: OutputFormat,
     pub verbose: bool,
+    pub quick: bool,
+    /// Spill verification results to sorted disk runs past this many
+    /// buffered bytes; None keeps the in-memory path.
+    pub memory_limit: Option<u64>,
 }
 
 pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
@@ -174,9 +321,17 @@ pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
             .build_global();
     }
 
+    // Reject the combination before the (potentially hours-long) hash pass,
+    // not after it: the spilled report is a single streaming pass, and only
+    // txt and ndjson put the summary last.
+    if config.memory_limit.is_some() && config.output_format == OutputFormat::Json {
+        anyhow::bail!(
+            "--memory-limit cannot build a single JSON document; use --output-format ndjson (or txt)"
+        );
+    }
+
     let start_time = Instant::now();
-    let snapshot_file = File::open(&config.snapshot_path)?;
-    let snapshot: Snapshot = serde_json::from_reader(snapshot_file)?;
+    let snapshot = load_snapshot(&config.snapshot_path)?;
 
     println!(
         "Verifying against snapshot created at: {}",
@@ -222,35 +377,58 @@ pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
         .map(|f| (f.rel_path.clone(), f))
         .collect();
 
-    let pb = if io::stderr().is_terminal() {
-        let pb = ProgressBar::new(snapshot_map.len() as u64);
+    // Weight the bar by snapshotted bytes so the ETA holds up when a few
+    // large files dominate.
+    let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+        let total_bytes: u64 = snapshot_map.values().map(|e| e.size.max(1)).sum();
+        let pb = ProgressBar::new(total_bytes);
         pb.set_style(
             ProgressStyle::default_bar()
-                .template("{spinner:.green} Verifying {bar:40.cyan/blue} {pos}/{len}")?,
+                .template("{spinner:.green} Verifying {bar:40.cyan/blue} {bytes}/{total_bytes}")?,
         );
         Some(pb)
     } else {
         None
     };
+    let progress = crate::utils::BatchedProgress::new(pb, 4 << 20);
 
-    let snapshot_keys: Vec<PathBuf> = snapshot_map.keys().cloned().collect();
-
-    let mut results: Vec<ComparisonResult> = snapshot_keys
-        .par_iter()
-        .map(|rel_path| {
-            if let Some(ref p) = pb {
-                p.inc(1);
-            }
-            let snap_entry = snapshot_map.get(rel_path).unwrap();
+    // One verification verdict per snapshot entry; shared by the in-memory
+    // collect and the --memory-limit spill path.
+    let process = |rel_path: &PathBuf, snap_entry: &SnapshotEntry| -> Result<ComparisonResult> {
+        {
+            progress.add(snap_entry.size.max(1));
 
             if let Some(curr_entry) = current_map.get(rel_path) {
+                // Quick mode: trust an exact size+mtime match against the
+                // snapshot and skip rehashing. Entries with a size or mtime
+                // mismatch — or with no stored mtime to compare — still get
+                // the full hash check below.
+                if config.quick
+                    && curr_entry.size == snap_entry.size
+                    && snap_entry.modified.is_some()
+                    && curr_entry.modified == snap_entry.modified
+                {
+                    return Ok(ComparisonResult {
+                        file: rel_path.clone(),
+                        status: Status::Match,
+                        hash1: Some(snap_entry.hashes.clone()),
+                        hash2: None,
+                        size1: Some(snap_entry.size),
+                        size2: Some(curr_entry.size),
+                        modified1: None,
+                        modified2: None,
+                        symlink1: snap_entry.symlink_target.clone(),
+                        symlink2: curr_entry.symlink_target.clone(),
+                    });
+                }
+
                 // Fix #10: propagate hashing errors instead of silently treating
                 // them as DIFF (the old unwrap_or behaviour).
                 let h = compute_hashes(&curr_entry.path, snapshot.algo)
                     .context("Failed to hash file during verification")?;
 
                 let status = match snapshot.algo {
-                    HashAlgo::Sha256 => {
+                    HashAlgo::Sha256 | HashAlgo::Sha256Tree => {
                         if h.sha256 == snap_entry.hashes.sha256 {
                             Status::Match
                         } else {
@@ -273,6 +451,13 @@ pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
                             Status::Diff
                         }
                     }
+                    HashAlgo::Xxh3 => {
+                        if h.xxh3 == snap_entry.hashes.xxh3 {
+                            Status::Match
+                        } else {
+                            Status::Diff
+                        }
+                    }
                 };
 
                 Ok(ComparisonResult {
@@ -295,13 +480,66 @@ pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
                 r.symlink1 = snap_entry.symlink_target.clone();
                 Ok(r)
             }
-        })
-        .collect::<Result<Vec<_>>>()?;
+        }
+    };
 
-    if let Some(ref p) = pb {
-        p.finish_with_message("Verification complete");
+    let report_conf = ReportConfig {
+        mode: Mode::Batch,
+        algo: snapshot.algo,
+        threads: config.threads,
+        verbose: config.verbose,
+    };
+
+    // Under --memory-limit, verification results stream through the
+    // external sorter exactly like run_batch's: a channel drains the rayon
+    // workers while this thread buffers and spills, and the report is
+    // written from the k-way merge.
+    if let Some(budget) = config.memory_limit {
+        let mut sorter = ExternalSorter::new(budget as usize);
+        std::thread::scope(|s| -> Result<()> {
+            let (tx, rx) = std::sync::mpsc::channel::<Result<ComparisonResult>>();
+            let process = &process;
+            let snapshot_map = &snapshot_map;
+            s.spawn(move || {
+                snapshot_map
+                    .par_iter()
+                    .for_each_with(tx, |tx, (rel_path, snap_entry)| {
+                        let _ = tx.send(process(rel_path, snap_entry));
+                    });
+            });
+            for r in rx {
+                sorter.push(r?)?;
+            }
+            Ok(())
+        })?;
+
+        progress.finish("Verification complete");
+
+        for (rel_path, curr_entry) in &current_map {
+            if !snapshot_map.contains_key(rel_path) {
+                let mut r = ComparisonResult::extra(rel_path.clone());
+                r.size2 = Some(curr_entry.size);
+                r.symlink2 = curr_entry.symlink_target.clone();
+                sorter.push(r)?;
+            }
+        }
+
+        return write_snapshot_report_spilled(
+            sorter,
+            &current_errors,
+            config.output_format,
+            &report_conf,
+            start_time,
+        );
     }
 
+    let mut results: Vec<ComparisonResult> = snapshot_map
+        .par_iter()
+        .map(|(rel_path, snap_entry)| process(rel_path, snap_entry))
+        .collect::<Result<Vec<_>>>()?;
+
+    progress.finish("Verification complete");
+
     // Collect all paths that were checked in the snapshot loop.
     // Clone into an owned HashSet so the immutable borrow on `results`
     // is released before we push EXTRA entries. (Fix for E0502)
@@ -337,10 +575,142 @@ pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
         }
     }
 
+    let summary_data = SummaryData {
+        total: results.len(),
+        matches,
+        diffs,
+        missing,
+        extra,
+        errors: current_errors.len(),
+        elapsed: start_time.elapsed(),
+    };
+
+    write_snapshot_report(
+        config.output_format,
+        &results,
+        &current_errors,
+        &summary_data,
+        &report_conf,
+    )?;
+
+    if !current_errors.is_empty() {
+        Ok(ExitStatus::Error)
+    } else if diffs > 0 || missing > 0 || extra > 0 {
+        Ok(ExitStatus::Diff)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
+
+pub struct DiffSnapshotsConfig {
+    pub snapshot1: PathBuf,
+    pub snapshot2: PathBuf,
+    pub output_format: OutputFormat,
+    pub verbose: bool,
+}
+
+/// Join two snapshot files on rel_path and report purely from the stored
+/// hashes — the data trees themselves are never touched, so diffing two
+/// archive snapshots takes seconds regardless of how big the archives are.
+pub fn diff_snapshots(config: DiffSnapshotsConfig) -> Result<ExitStatus> {
+    let start_time = Instant::now();
+    let snap1 = load_snapshot(&config.snapshot1)?;
+    let snap2 = load_snapshot(&config.snapshot2)?;
+
+    // The snapshots must share at least one digest algorithm to be joinable.
+    let algo = match (snap1.algo, snap2.algo) {
+        (a, b) if a == b => a,
+        // `Both` stores exactly sha256 + blake3: it cannot stand in for
+        // xxh3, nor for a tree digest (which lives in the sha256 slot but
+        // is not a plain sha256).
+        (HashAlgo::Both, other) | (other, HashAlgo::Both)
+            if matches!(other, HashAlgo::Sha256 | HashAlgo::Blake3) =>
+        {
+            other
+        }
+        (a, b) => anyhow::bail!(
+            "Snapshots use incompatible hash algorithms ({:?} vs {:?}); \
+             re-create one of them with --algo both",
+            a,
+            b
+        ),
+    };
+
+    println!(
+        "Diffing snapshots: {} ({}) vs {} ({})",
+        config.snapshot1.display(),
+        snap1.created_at.cyan(),
+        config.snapshot2.display(),
+        snap2.created_at.cyan()
+    );
+
+    let mut map2: HashMap<PathBuf, SnapshotEntry> = snap2
+        .files
+        .into_iter()
+        .map(|f| (f.rel_path.clone(), f))
+        .collect();
+
+    let mut results: Vec<ComparisonResult> = Vec::with_capacity(snap1.files.len());
+    for e1 in snap1.files {
+        if let Some(e2) = map2.remove(&e1.rel_path) {
+            let status = match (
+                e1.hashes.primary_digest(algo),
+                e2.hashes.primary_digest(algo),
+            ) {
+                (Some(h1), Some(h2)) if h1 == h2 => Status::Match,
+                (Some(_), Some(_)) => Status::Diff,
+                // A missing digest (e.g. metadata-only entry) cannot prove
+                // equality, so report it as a difference rather than guess.
+                _ => Status::Diff,
+            };
+            results.push(ComparisonResult {
+                file: e1.rel_path,
+                status,
+                hash1: Some(e1.hashes),
+                hash2: Some(e2.hashes),
+                size1: Some(e1.size),
+                size2: Some(e2.size),
+                modified1: None,
+                modified2: None,
+                symlink1: e1.symlink_target,
+                symlink2: e2.symlink_target,
+            });
+        } else {
+            let mut r = ComparisonResult::missing(e1.rel_path.clone());
+            r.hash1 = Some(e1.hashes);
+            r.size1 = Some(e1.size);
+            r.symlink1 = e1.symlink_target;
+            results.push(r);
+        }
+    }
+    for (rel_path, e2) in map2 {
+        let mut r = ComparisonResult::extra(rel_path);
+        r.hash2 = Some(e2.hashes);
+        r.size2 = Some(e2.size);
+        r.symlink2 = e2.symlink_target;
+        results.push(r);
+    }
+
+    results.sort_by(|a, b| a.file.cmp(&b.file));
+
+    let mut matches = 0;
+    let mut diffs = 0;
+    let mut missing = 0;
+    let mut extra = 0;
+    for r in &results {
+        match r.status {
+            Status::Match => matches += 1,
+            Status::Diff => diffs += 1,
+            Status::Missing => missing += 1,
+            Status::Extra => extra += 1,
+            _ => (),
+        }
+    }
+
     let report_conf = ReportConfig {
         mode: Mode::Batch,
-        algo: snapshot.algo,
-        threads: config.threads,
+        algo,
+        threads: None,
         verbose: config.verbose,
     };
 
@@ -350,20 +720,120 @@ pub fn verify_snapshot(config: VerifyConfig) -> Result<ExitStatus> {
         diffs,
         missing,
         extra,
-        errors: current_errors.len(),
+        errors: 0,
         elapsed: start_time.elapsed(),
     };
 
-    let report = match config.output_format {
+    write_snapshot_report(
+        config.output_format,
+        &results,
+        &[],
+        &summary_data,
+        &report_conf,
+    )?;
+
+    if diffs > 0 || missing > 0 || extra > 0 {
+        Ok(ExitStatus::Diff)
+    } else {
+        Ok(ExitStatus::Success)
+    }
+}
+
+/// Stream the verify/diff report to stdout in the requested format.
+/// Neither subcommand takes an output folder, so the sink is always stdout;
+/// going through the streaming writers keeps memory flat on huge snapshots.
+fn write_snapshot_report(
+    format: OutputFormat,
+    results: &[ComparisonResult],
+    errors: &[ErrorEntry],
+    summary_data: &SummaryData,
+    report_conf: &ReportConfig,
+) -> Result<()> {
+    let (mut sink, _) = open_report_sink(&None, report_filename(format))?;
+    match format {
         OutputFormat::Txt => {
-            generate_text_report(&results, &[], &current_errors, &summary_data, &report_conf)?
+            write_text_report(&mut *sink, results, &[], errors, summary_data, report_conf)?
         }
-        OutputFormat::Json => generate_json_report(&results, &[], &current_errors, &summary_data)?,
-    };
+        OutputFormat::Json => write_json_report(&mut *sink, results, &[], errors, summary_data)?,
+        OutputFormat::Ndjson => {
+            write_ndjson_report(&mut *sink, results, &[], errors, summary_data)?
+        }
+    }
+    sink.flush()?;
+    Ok(())
+}
 
-    println!("{}", report);
+/// Streaming counterpart of [`write_snapshot_report`] for --memory-limit
+/// runs: one result at a time straight off the external sorter's merge,
+/// counting statuses along the way. Only txt and ndjson put the summary
+/// last; verify_snapshot rejects the single-document json format before
+/// any hashing starts.
+fn write_snapshot_report_spilled(
+    sorter: ExternalSorter,
+    errors: &[ErrorEntry],
+    format: OutputFormat,
+    report_conf: &ReportConfig,
+    start_time: Instant,
+) -> Result<ExitStatus> {
+    let ndjson = format == OutputFormat::Ndjson;
+    let total = sorter.len();
+
+    let (mut sink, _) = open_report_sink(&None, report_filename(format))?;
+    for e in errors {
+        if ndjson {
+            write_ndjson_error(&mut *sink, e, "folder")?;
+        } else {
+            writeln!(
+                sink,
+                "[{}] {} (folder: {})",
+                "ERROR".red().on_white(),
+                e.path.display(),
+                e.error
+            )?;
+        }
+    }
 
-    if !current_errors.is_empty() {
+    let (mut matches, mut diffs, mut missing, mut extra) = (0, 0, 0, 0);
+    for result in sorter.into_sorted_iter()? {
+        let result = result?;
+        match result.status {
+            Status::Match => matches += 1,
+            Status::Diff => diffs += 1,
+            Status::Missing => missing += 1,
+            Status::Extra => extra += 1,
+            _ => (),
+        }
+        if ndjson {
+            write_ndjson_result(&mut *sink, &result)?;
+        } else {
+            sink.write_all(
+                result
+                    .format_text(report_conf.verbose, report_conf.algo)?
+                    .as_bytes(),
+            )?;
+        }
+    }
+
+    let summary_data = SummaryData {
+        total,
+        matches,
+        diffs,
+        missing,
+        extra,
+        errors: errors.len(),
+        elapsed: start_time.elapsed(),
+    };
+    if ndjson {
+        write_ndjson_summary(&mut *sink, &summary_data)?;
+    } else {
+        writeln!(sink)?;
+        for line in generate_summary_text(&summary_data, report_conf) {
+            writeln!(sink, "{}", line)?;
+        }
+    }
+    sink.flush()?;
+
+    if !errors.is_empty() {
         Ok(ExitStatus::Error)
     } else if diffs > 0 || missing > 0 || extra > 0 {
         Ok(ExitStatus::Diff)
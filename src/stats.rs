@@ -0,0 +1,104 @@
+//! Per-phase performance counters behind the global --stats flag.
+//!
+//! Counters are process-wide relaxed atomics so the hot paths (hashing on
+//! the Rayon pool, the parallel walk) can record into them without any
+//! locking or plumbing through call signatures. When --stats is off the
+//! instrumented sites pay a single relaxed load and skip the clock reads.
+//!
+//! The collected numbers are emitted as one JSON object on stderr after
+//! the normal report, so nightly runs can be graphed across time without
+//! disturbing stdout parsing.
+
+use std::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use std::time::Duration;
+
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+static WALK_NANOS: AtomicU64 = AtomicU64::new(0);
+static WALK_ENTRIES: AtomicU64 = AtomicU64::new(0);
+static HASH_NANOS: AtomicU64 = AtomicU64::new(0);
+static HASH_BYTES: AtomicU64 = AtomicU64::new(0);
+static HASH_FILES: AtomicU64 = AtomicU64::new(0);
+static MAP_BUILD_NANOS: AtomicU64 = AtomicU64::new(0);
+static SORT_NANOS: AtomicU64 = AtomicU64::new(0);
+static APPLY_NANOS: AtomicU64 = AtomicU64::new(0);
+
+pub fn enable() {
+    ENABLED.store(true, Ordering::Relaxed);
+}
+
+#[inline]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+fn add_nanos(counter: &AtomicU64, d: Duration) {
+    counter.fetch_add(d.as_nanos() as u64, Ordering::Relaxed);
+}
+
+pub fn record_walk(d: Duration, entries: u64) {
+    add_nanos(&WALK_NANOS, d);
+    WALK_ENTRIES.fetch_add(entries, Ordering::Relaxed);
+}
+
+pub fn record_hash(bytes: u64, d: Duration) {
+    add_nanos(&HASH_NANOS, d);
+    HASH_BYTES.fetch_add(bytes, Ordering::Relaxed);
+    HASH_FILES.fetch_add(1, Ordering::Relaxed);
+}
+
+pub fn record_map_build(d: Duration) {
+    add_nanos(&MAP_BUILD_NANOS, d);
+}
+
+pub fn record_sort(d: Duration) {
+    add_nanos(&SORT_NANOS, d);
+}
+
+pub fn record_apply(d: Duration) {
+    add_nanos(&APPLY_NANOS, d);
+}
+
+/// Print the collected counters as a single JSON object on stderr.
+/// No-op unless --stats was passed.
+pub fn emit() {
+    if !enabled() {
+        return;
+    }
+
+    let walk_nanos = WALK_NANOS.load(Ordering::Relaxed);
+    let walk_entries = WALK_ENTRIES.load(Ordering::Relaxed);
+    let hash_nanos = HASH_NANOS.load(Ordering::Relaxed);
+    let hash_bytes = HASH_BYTES.load(Ordering::Relaxed);
+
+    let per_sec = |amount: u64, nanos: u64| {
+        if nanos == 0 {
+            0.0
+        } else {
+            amount as f64 / (nanos as f64 / 1e9)
+        }
+    };
+
+    let stats = serde_json::json!({
+        "stats": {
+            "walk": {
+                "nanos": walk_nanos,
+                "entries": walk_entries,
+                "entries_per_sec": per_sec(walk_entries, walk_nanos),
+            },
+            "hash": {
+                // Nanos are summed across Rayon workers, so mb_per_sec is
+                // per-thread throughput, not wall-clock aggregate.
+                "nanos": hash_nanos,
+                "bytes": hash_bytes,
+                "files": HASH_FILES.load(Ordering::Relaxed),
+                "mb_per_sec": per_sec(hash_bytes, hash_nanos) / 1e6,
+            },
+            "map_build_nanos": MAP_BUILD_NANOS.load(Ordering::Relaxed),
+            "sort_nanos": SORT_NANOS.load(Ordering::Relaxed),
+            "apply_nanos": APPLY_NANOS.load(Ordering::Relaxed),
+        }
+    });
+
+    eprintln!("{}", stats);
+}
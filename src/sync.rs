@@ -9,9 +9,10 @@ use std::path::PathBuf;
 use std::time::Instant;
 
 use crate::compare::ExitStatus;
-use crate::models::{ComparisonResult, FileEntry, HashAlgo, Mode, Status, SymlinkMode};
+use crate::delta::delta_update;
+use crate::models::{ComparisonResult, CopyMode, FileEntry, HashAlgo, Mode, Status, SymlinkMode};
 use crate::report::{ReportConfig, SummaryData, generate_summary_text, print_error_entry};
-use crate::utils::{collect_files, compute_hashes};
+use crate::utils::{collect_files, compute_hashes, copy_file};
 
 pub struct SyncConfig {
     pub source: PathBuf,
@@ -27,6 +28,8 @@ pub struct SyncConfig {
     pub types: Option<Vec<String>>,
     pub ignore: Option<Vec<String>>,
     pub threads: Option<usize>,
+    pub copy_mode: CopyMode,
+    pub delta: bool,
 }
 
 pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
@@ -126,11 +129,17 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
         .map(|p| (*p).clone())
         .collect();
 
-    let pb = if io::stderr().is_terminal() {
-        let pb = ProgressBar::new(common_paths.len() as u64);
+    // Weight the bar by bytes so the ETA holds up when a few large files
+    // dominate the common set.
+    let pb = if io::stderr().is_terminal() && !crate::report::quiet() {
+        let total_bytes: u64 = common_paths
+            .iter()
+            .map(|p| source_map.get(p).map_or(0, |e| e.size).max(1))
+            .sum();
+        let pb = ProgressBar::new(total_bytes);
         pb.set_style(
             ProgressStyle::default_bar()
-                .template("{spinner:.green} [Elap>{elapsed_precise}] [ {bar:40.cyan/blue} ] {pos}/{len} (Rema>{eta})")?
+                .template("{spinner:.green} [Elap>{elapsed_precise}] [ {bar:40.cyan/blue} ] {bytes}/{total_bytes} (Rema>{eta})")?
                 .progress_chars("#>- ")
         );
         pb.set_draw_target(indicatif::ProgressDrawTarget::stderr_with_hz(10));
@@ -138,15 +147,14 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
     } else {
         None
     };
+    let progress = crate::utils::BatchedProgress::new(pb, 4 << 20);
 
     let sync_actions: Vec<ComparisonResult> = common_paths
         .par_iter()
         .filter_map(|rel_path| {
-            if let Some(ref p) = pb {
-                p.inc(1);
-            }
             let source_entry = source_map.get(rel_path).unwrap();
             let dest_entry = dest_map.get(rel_path).unwrap();
+            progress.add(source_entry.size.max(1));
 
             // Fix #2: fast-path size check applies regardless of algorithm —
             //   if sizes differ we already know it's a DIFF, no hashing needed.
@@ -179,11 +187,12 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
 
             let result = match (h_source_res, h_dest_res) {
                 (Ok(h_source), Ok(h_dest)) => match config.algo {
-                    HashAlgo::Sha256 => h_source.sha256 != h_dest.sha256,
+                    HashAlgo::Sha256 | HashAlgo::Sha256Tree => h_source.sha256 != h_dest.sha256,
                     HashAlgo::Blake3 => h_source.blake3 != h_dest.blake3,
                     HashAlgo::Both => {
                         h_source.sha256 != h_dest.sha256 || h_source.blake3 != h_dest.blake3
                     }
+                    HashAlgo::Xxh3 => h_source.xxh3 != h_dest.xxh3,
                 },
                 _ => true, // Treat hashing errors as differences
             };
@@ -207,9 +216,7 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
         })
         .collect::<Result<Vec<_>>>()?;
 
-    if let Some(ref p) = pb {
-        p.finish_with_message("Comparison complete for common files");
-    }
+    progress.finish("Comparison complete for common files");
 
     let mut actions: Vec<ComparisonResult> = Vec::new();
     let mut created_count = 0;
@@ -221,6 +228,8 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
     for rel_path in source_paths.difference(&dest_paths) {
         let mut r = ComparisonResult::missing((*rel_path).clone());
         r.status = Status::Create;
+        // Carry the source size so the apply phase can schedule big copies first.
+        r.size1 = source_map.get(*rel_path).map(|e| e.size);
         actions.push(r);
     }
 
@@ -245,7 +254,7 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
         println!("\nApplying synchronization actions...");
     }
 
-    let action_pb = if io::stderr().is_terminal() {
+    let action_pb = if io::stderr().is_terminal() && !crate::report::quiet() {
         let pb = ProgressBar::new(actions.len() as u64);
         pb.set_style(ProgressStyle::default_bar().template(
             "{spinner:.green} [Elap>{elapsed_precise}] {msg}: {bar:40.cyan/blue} {pos}/{len} ({eta})",
@@ -255,15 +264,12 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
         None
     };
 
-    for action in actions {
-        if let Some(ref p) = action_pb {
-            p.inc(1);
-            p.set_message(format!("Processing {}", action.file.display()));
-        }
-        let source_path = config.source.join(&action.file);
-        let dest_path = config.destination.join(&action.file);
-
-        if config.dry_run {
+    if config.dry_run {
+        for action in &actions {
+            if let Some(ref p) = action_pb {
+                p.inc(1);
+            }
+            let dest_path = config.destination.join(&action.file);
             match action.status {
                 Status::Create => println!(
                     "{} (Dry Run): Will create {}",
@@ -282,29 +288,90 @@ pub fn run_sync(config: SyncConfig) -> Result<ExitStatus> {
                 ),
                 _ => {}
             }
-        } else {
-            match action.status {
-                Status::Create | Status::Update => {
-                    let parent = dest_path
-                        .parent()
-                        .context("Failed to get parent directory")?;
-                    fs::create_dir_all(parent)?;
-                    fs::copy(&source_path, &dest_path)?;
-                    if action.status == Status::Create {
-                        created_count += 1;
-                        println!("{} {}", "CREATED".green(), dest_path.display());
-                    } else {
-                        updated_count += 1;
-                        println!("{} {}", "UPDATED".yellow(), dest_path.display());
-                    }
+        }
+    } else {
+        use std::sync::atomic::{AtomicUsize, Ordering};
+
+        let apply_timer = crate::stats::enabled().then(Instant::now);
+
+        // Deletes and copies touch disjoint rel_paths (a delete targets a
+        // path absent from the source), but a deleted file can free up a
+        // name a copy needs as a directory — so run the whole delete phase
+        // to completion before any copy starts.
+        let (deletes, mut copies): (Vec<_>, Vec<_>) = actions
+            .into_iter()
+            .partition(|a| a.status == Status::Delete);
+
+        let deleted = AtomicUsize::new(0);
+        deletes.par_iter().try_for_each(|action| -> Result<()> {
+            if let Some(ref p) = action_pb {
+                p.inc(1);
+                p.set_message(format!("Processing {}", action.file.display()));
+            }
+            let dest_path = config.destination.join(&action.file);
+            fs::remove_file(&dest_path)?;
+            deleted.fetch_add(1, Ordering::Relaxed);
+            if !crate::report::quiet() {
+                println!("{} {}", "DELETED".red(), dest_path.display());
+            }
+            Ok(())
+        })?;
+
+        // Largest files first: long copies start early instead of becoming
+        // the straggler at the end of the run. The -j flag bounds the
+        // concurrency via the Rayon pool as everywhere else.
+        copies.sort_by_key(|a| std::cmp::Reverse(a.size1.unwrap_or(0)));
+
+        let created = AtomicUsize::new(0);
+        let updated = AtomicUsize::new(0);
+        copies.par_iter().try_for_each(|action| -> Result<()> {
+            if let Some(ref p) = action_pb {
+                p.inc(1);
+                p.set_message(format!("Processing {}", action.file.display()));
+            }
+            let source_path = config.source.join(&action.file);
+            let dest_path = config.destination.join(&action.file);
+            let parent = dest_path
+                .parent()
+                .context("Failed to get parent directory")?;
+            fs::create_dir_all(parent)?;
+            if action.status == Status::Create {
+                copy_file(&source_path, &dest_path, config.copy_mode)?;
+                created.fetch_add(1, Ordering::Relaxed);
+                if !crate::report::quiet() {
+                    println!("{} {}", "CREATED".green(), dest_path.display());
                 }
-                Status::Delete => {
-                    fs::remove_file(&dest_path)?;
-                    deleted_count += 1;
-                    println!("{} {}", "DELETED".red(), dest_path.display());
+            } else if config.delta {
+                // Block-level delta: write only the regions that changed
+                // instead of recopying the whole file.
+                let stats = delta_update(&source_path, &dest_path, config.copy_mode)?;
+                updated.fetch_add(1, Ordering::Relaxed);
+                if !crate::report::quiet() {
+                    println!(
+                        "{} {} ({} literal / {} matched bytes{})",
+                        "UPDATED".yellow(),
+                        dest_path.display(),
+                        stats.literal_bytes,
+                        stats.matched_bytes,
+                        if stats.in_place { ", in place" } else { "" }
+                    );
+                }
+            } else {
+                copy_file(&source_path, &dest_path, config.copy_mode)?;
+                updated.fetch_add(1, Ordering::Relaxed);
+                if !crate::report::quiet() {
+                    println!("{} {}", "UPDATED".yellow(), dest_path.display());
                 }
-                _ => {}
             }
+            Ok(())
+        })?;
+
+        created_count = created.into_inner();
+        updated_count = updated.into_inner();
+        deleted_count = deleted.into_inner();
+
+        if let Some(t) = apply_timer {
+            crate::stats::record_apply(t.elapsed());
         }
     }
 
@@ -1,10 +1,11 @@
 #[cfg(test)]
 mod cmpf_tests {
+    use crate::cache::HashCache;
     use crate::compare::ExitStatus;
-    use crate::models::{HashAlgo, OutputFormat, SymlinkMode};
+    use crate::models::{CopyMode, HashAlgo, OutputFormat, SnapshotFormat, SymlinkMode};
     use crate::snapshot::{SnapshotConfig, VerifyConfig, create_snapshot, verify_snapshot};
     use crate::sync::{SyncConfig, run_sync};
-    use crate::utils::{collect_files, compute_hashes};
+    use crate::utils::{collect_files, compare_bytes, compute_hashes};
     use std::fs::{self, File};
     use std::io::Write;
     use tempfile::tempdir;
@@ -34,6 +35,137 @@ mod cmpf_tests {
         assert!(res_sha.sha256.is_some());
     }
 
+    #[test]
+    fn test_dir_index_rollups() {
+        use crate::models::DirIndex;
+        use std::path::{Path, PathBuf};
+
+        let side = |d_hash: &str| {
+            DirIndex::build(vec![
+                (PathBuf::from("a.txt"), Some("h1".to_string())),
+                (PathBuf::from("sub/b.txt"), Some("h2".to_string())),
+                (PathBuf::from("sub/deep/c.txt"), Some(d_hash.to_string())),
+            ])
+        };
+
+        let idx1 = side("h3");
+        let idx2 = side("h3");
+        // Identical trees agree at every level, including the root.
+        assert_eq!(idx1.rollup(Path::new("")), idx2.rollup(Path::new("")));
+        assert_eq!(idx1.rollup(Path::new("sub")), idx2.rollup(Path::new("sub")));
+
+        // One changed leaf digest propagates up the whole ancestor chain.
+        let idx3 = side("changed");
+        assert_ne!(idx1.rollup(Path::new("sub/deep")), idx3.rollup(Path::new("sub/deep")));
+        assert_ne!(idx1.rollup(Path::new("sub")), idx3.rollup(Path::new("sub")));
+        assert_ne!(idx1.rollup(Path::new("")), idx3.rollup(Path::new("")));
+
+        // An unknown digest taints the chain: no rollup, so never pruned.
+        let idx4 = DirIndex::build(vec![
+            (PathBuf::from("a.txt"), Some("h1".to_string())),
+            (PathBuf::from("sub/b.txt"), None),
+        ]);
+        assert!(idx4.rollup(Path::new("sub")).is_none());
+        assert!(idx4.rollup(Path::new("")).is_none());
+    }
+
+    #[test]
+    fn test_compute_hashes_sampled() {
+        use crate::utils::compute_hashes_sampled;
+
+        let dir = tempdir().unwrap();
+        let p = dir.path().join("media.bin");
+        let data = vec![0x5Au8; 8 * 1024 * 1024];
+        fs::write(&p, &data).unwrap();
+
+        let h1 = compute_hashes_sampled(&p, HashAlgo::Blake3, 1).unwrap();
+        assert!(h1.sampled);
+        // A sampled digest is distinct from the full digest of the same file.
+        let full = compute_hashes(&p, HashAlgo::Blake3).unwrap();
+        assert!(!full.sampled);
+        assert_ne!(h1.blake3, full.blake3);
+
+        // Truncation changes the length (and the last block), so it is caught.
+        fs::write(&p, &data[..6 * 1024 * 1024]).unwrap();
+        let h2 = compute_hashes_sampled(&p, HashAlgo::Blake3, 1).unwrap();
+        assert_ne!(h1.blake3, h2.blake3);
+
+        // Corrupting the first block is caught too.
+        let mut corrupted = data.clone();
+        corrupted[100] = 0xFF;
+        fs::write(&p, &corrupted).unwrap();
+        let h3 = compute_hashes_sampled(&p, HashAlgo::Blake3, 1).unwrap();
+        assert_ne!(h1.blake3, h3.blake3);
+    }
+
+    #[test]
+    fn test_compare_bytes() {
+        let dir = tempdir().unwrap();
+        let p1 = dir.path().join("a.bin");
+        let p2 = dir.path().join("b.bin");
+        let p3 = dir.path().join("c.bin");
+
+        fs::write(&p1, b"identical content").unwrap();
+        fs::write(&p2, b"identical content").unwrap();
+        fs::write(&p3, b"different content").unwrap();
+
+        assert!(compare_bytes(&p1, &p2).unwrap());
+        assert!(!compare_bytes(&p1, &p3).unwrap());
+
+        // Above the mmap threshold, with the difference in the first block.
+        let big1 = vec![0xAAu8; 64 * 1024];
+        let mut big2 = big1.clone();
+        big2[10] = 0xBB;
+        fs::write(&p1, &big1).unwrap();
+        fs::write(&p2, &big1).unwrap();
+        fs::write(&p3, &big2).unwrap();
+        assert!(compare_bytes(&p1, &p2).unwrap());
+        assert!(!compare_bytes(&p1, &p3).unwrap());
+    }
+
+    #[test]
+    fn test_hash_cache_invalidation() {
+        let dir = tempdir().unwrap();
+        let cache_dir = dir.path().join("cache");
+        let file_path = dir.path().join("data.txt");
+
+        let mut f = File::create(&file_path).unwrap();
+        writeln!(f, "version one").unwrap();
+        drop(f);
+        let old_mtime = std::time::SystemTime::UNIX_EPOCH + std::time::Duration::from_secs(1000);
+        File::options()
+            .write(true)
+            .open(&file_path)
+            .unwrap()
+            .set_modified(old_mtime)
+            .unwrap();
+
+        let meta = fs::metadata(&file_path).unwrap();
+        let cache = HashCache::open(Some(&cache_dir)).unwrap();
+
+        let h1 = cache
+            .get_or_compute(&file_path, meta.len(), meta.modified().ok(), HashAlgo::Blake3)
+            .unwrap();
+        // Second lookup with unchanged metadata must be a hit with the same digest.
+        let h2 = cache
+            .get_or_compute(&file_path, meta.len(), meta.modified().ok(), HashAlgo::Blake3)
+            .unwrap();
+        assert_eq!(h1.blake3, h2.blake3);
+        cache.save().unwrap();
+
+        // Change content and mtime: a reloaded cache must rehash, not reuse.
+        let mut f = File::create(&file_path).unwrap();
+        writeln!(f, "version two!").unwrap();
+        drop(f);
+        let meta = fs::metadata(&file_path).unwrap();
+
+        let cache = HashCache::open(Some(&cache_dir)).unwrap();
+        let h3 = cache
+            .get_or_compute(&file_path, meta.len(), meta.modified().ok(), HashAlgo::Blake3)
+            .unwrap();
+        assert_ne!(h1.blake3, h3.blake3);
+    }
+
     #[test]
     fn test_collect_files_basic() {
         let dir = tempdir().unwrap();
@@ -90,9 +222,9 @@ mod cmpf_tests {
         let mut file = File::create(&file_path).unwrap();
         writeln!(file, "content").unwrap();
 
-        let snapshot_path = dir.path().join("snap.json");
+        let snapshot_path = dir.path().join("snap.cmpf");
 
-        // Create snapshot
+        // Create snapshot (binary format, the default)
         create_snapshot(SnapshotConfig {
             folder: folder.clone(),
             output: Some(snapshot_path.clone()),
@@ -104,6 +236,7 @@ mod cmpf_tests {
             ignore: None,
             symlinks: SymlinkMode::Ignore,
             threads: None,
+            format: SnapshotFormat::Binary,
         })
         .unwrap();
 
@@ -116,6 +249,8 @@ mod cmpf_tests {
             threads: None,
             output_format: OutputFormat::Txt,
             verbose: false,
+            quick: false,
+            memory_limit: None,
         })
         .unwrap();
         assert_eq!(status, ExitStatus::Success);
@@ -129,11 +264,208 @@ mod cmpf_tests {
             threads: None,
             output_format: OutputFormat::Txt,
             verbose: false,
+            quick: false,
+            memory_limit: None,
+        })
+        .unwrap();
+        assert_eq!(status, ExitStatus::Diff);
+    }
+
+    #[test]
+    fn test_delta_update() {
+        use crate::delta::delta_update;
+
+        let dir = tempdir().unwrap();
+        let src_path = dir.path().join("src.bin");
+        let dst_path = dir.path().join("dst.bin");
+
+        // 512 KiB of xorshift noise so every block is distinct.
+        let mut x = 0x12345678u32;
+        let base: Vec<u8> = (0..512 * 1024)
+            .map(|_| {
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                x as u8
+            })
+            .collect();
+
+        // In-place case: a small edit in the middle, no shifting.
+        let mut edited = base.clone();
+        edited[300_000..300_016].copy_from_slice(b"EDITEDEDITEDEDIT");
+        fs::write(&src_path, &edited).unwrap();
+        fs::write(&dst_path, &base).unwrap();
+
+        let stats = delta_update(&src_path, &dst_path, CopyMode::Standard).unwrap();
+        assert_eq!(fs::read(&dst_path).unwrap(), edited);
+        assert!(stats.in_place);
+        assert!(stats.literal_bytes < base.len() as u64 / 4);
+        assert!(stats.matched_bytes > 0);
+
+        // Shifted case: an insertion moves everything behind it, forcing
+        // the rebuild path — the result must still match exactly.
+        let mut shifted = base.clone();
+        shifted.splice(100_000..100_000, b"INSERTED BYTES".iter().copied());
+        fs::write(&src_path, &shifted).unwrap();
+        fs::write(&dst_path, &base).unwrap();
+
+        let stats = delta_update(&src_path, &dst_path, CopyMode::Standard).unwrap();
+        assert_eq!(fs::read(&dst_path).unwrap(), shifted);
+        assert!(!stats.in_place);
+        assert!(stats.matched_bytes > 0);
+    }
+
+    #[test]
+    fn test_diff_snapshots() {
+        use crate::snapshot::{DiffSnapshotsConfig, diff_snapshots};
+
+        let dir = tempdir().unwrap();
+        let folder = dir.path().join("data");
+        fs::create_dir(&folder).unwrap();
+        let file_path = folder.join("file.txt");
+        let mut file = File::create(&file_path).unwrap();
+        writeln!(file, "content").unwrap();
+
+        let snap_config = |output| SnapshotConfig {
+            folder: folder.clone(),
+            output: Some(output),
+            algo: HashAlgo::Blake3,
+            depth: None,
+            no_recursive: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            symlinks: SymlinkMode::Ignore,
+            threads: None,
+            format: SnapshotFormat::Binary,
+        };
+
+        let snap_a = dir.path().join("a.cmpf");
+        let snap_b = dir.path().join("b.cmpf");
+        create_snapshot(snap_config(snap_a.clone())).unwrap();
+
+        // Identical trees diff clean.
+        create_snapshot(snap_config(snap_b.clone())).unwrap();
+        let status = diff_snapshots(DiffSnapshotsConfig {
+            snapshot1: snap_a.clone(),
+            snapshot2: snap_b.clone(),
+            output_format: OutputFormat::Txt,
+            verbose: false,
+        })
+        .unwrap();
+        assert_eq!(status, ExitStatus::Success);
+
+        // Change a file, add a new one, re-snapshot: the diff sees both
+        // without ever touching the data tree again.
+        let mut file = File::create(&file_path).unwrap();
+        writeln!(file, "changed").unwrap();
+        let mut extra = File::create(folder.join("new.txt")).unwrap();
+        writeln!(extra, "extra").unwrap();
+        create_snapshot(snap_config(snap_b.clone())).unwrap();
+
+        let status = diff_snapshots(DiffSnapshotsConfig {
+            snapshot1: snap_a,
+            snapshot2: snap_b,
+            output_format: OutputFormat::Txt,
+            verbose: false,
+        })
+        .unwrap();
+        assert_eq!(status, ExitStatus::Diff);
+    }
+
+    #[test]
+    fn test_quick_verify() {
+        let dir = tempdir().unwrap();
+        let folder = dir.path().join("data");
+        fs::create_dir(&folder).unwrap();
+        let file_path = folder.join("file.txt");
+        let mut file = File::create(&file_path).unwrap();
+        writeln!(file, "content").unwrap();
+
+        let snapshot_path = dir.path().join("snap.cmpf");
+        create_snapshot(SnapshotConfig {
+            folder: folder.clone(),
+            output: Some(snapshot_path.clone()),
+            algo: HashAlgo::Blake3,
+            depth: None,
+            no_recursive: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            symlinks: SymlinkMode::Ignore,
+            threads: None,
+            format: SnapshotFormat::Binary,
+        })
+        .unwrap();
+
+        // Untouched file: size+mtime match, trusted without rehashing.
+        let status = verify_snapshot(VerifyConfig {
+            folder: folder.clone(),
+            snapshot_path: snapshot_path.clone(),
+            threads: None,
+            output_format: OutputFormat::Txt,
+            verbose: false,
+            quick: true,
+            memory_limit: None,
+        })
+        .unwrap();
+        assert_eq!(status, ExitStatus::Success);
+
+        // Rewriting the file bumps the mtime, so quick mode falls back to
+        // hashing and catches the change.
+        let mut file = File::create(&file_path).unwrap();
+        writeln!(file, "changed").unwrap();
+        let status = verify_snapshot(VerifyConfig {
+            folder,
+            snapshot_path,
+            threads: None,
+            output_format: OutputFormat::Txt,
+            verbose: false,
+            quick: true,
+            memory_limit: None,
         })
         .unwrap();
         assert_eq!(status, ExitStatus::Diff);
     }
 
+    #[test]
+    fn test_snapshot_json_format_still_verifies() {
+        let dir = tempdir().unwrap();
+        let folder = dir.path().join("data");
+        fs::create_dir(&folder).unwrap();
+        let mut file = File::create(folder.join("file.txt")).unwrap();
+        writeln!(file, "content").unwrap();
+
+        let snapshot_path = dir.path().join("snap.json");
+
+        create_snapshot(SnapshotConfig {
+            folder: folder.clone(),
+            output: Some(snapshot_path.clone()),
+            algo: HashAlgo::Blake3,
+            depth: None,
+            no_recursive: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            symlinks: SymlinkMode::Ignore,
+            threads: None,
+            format: SnapshotFormat::Json,
+        })
+        .unwrap();
+
+        let status = verify_snapshot(VerifyConfig {
+            folder,
+            snapshot_path,
+            threads: None,
+            output_format: OutputFormat::Txt,
+            verbose: false,
+            quick: false,
+            memory_limit: None,
+        })
+        .unwrap();
+        assert_eq!(status, ExitStatus::Success);
+    }
+
     #[test]
     fn test_sync_basic() {
         let dir = tempdir().unwrap();
@@ -161,6 +493,8 @@ mod cmpf_tests {
             types: None,
             ignore: None,
             threads: None,
+            copy_mode: CopyMode::Auto,
+            delta: false,
         })
         .unwrap();
 
@@ -269,9 +603,461 @@ mod cmpf_tests {
             types: None,
             ignore: None,
             threads: None,
+            copy_mode: CopyMode::Auto,
+            delta: false,
         })
         .unwrap();
 
         assert!(!dst.join("file.txt").exists());
     }
+
+    #[test]
+    fn test_dedupe() {
+        use crate::dedupe::{DedupeConfig, run_dedupe};
+
+        let dir = tempdir().unwrap();
+        let folder = dir.path().join("data");
+        fs::create_dir(&folder).unwrap();
+        fs::write(folder.join("a1.txt"), "duplicate body").unwrap();
+        fs::write(folder.join("a2.txt"), "duplicate body").unwrap();
+        // Same size as the duplicates but different content: hashed, not
+        // clustered.
+        fs::write(folder.join("b.txt"), "unique body!!!").unwrap();
+        // Unique size: never hashed at all.
+        fs::write(folder.join("c.txt"), "short").unwrap();
+        // Hardlinks share storage, so they must not count as reclaimable.
+        #[cfg(unix)]
+        fs::hard_link(folder.join("c.txt"), folder.join("c_link.txt")).unwrap();
+
+        let config = |folder: std::path::PathBuf| DedupeConfig {
+            folder,
+            algo: HashAlgo::Blake3,
+            output_folder: None,
+            output_format: OutputFormat::Txt,
+            depth: None,
+            no_recursive: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            symlinks: SymlinkMode::Ignore,
+            threads: None,
+        };
+
+        // One duplicate cluster: exit status Diff.
+        assert_eq!(run_dedupe(config(folder.clone())).unwrap(), ExitStatus::Diff);
+
+        // A tree without duplicates comes back clean.
+        let clean = dir.path().join("clean");
+        fs::create_dir(&clean).unwrap();
+        fs::write(clean.join("x.txt"), "one").unwrap();
+        fs::write(clean.join("y.txt"), "two2").unwrap();
+        assert_eq!(run_dedupe(config(clean)).unwrap(), ExitStatus::Success);
+    }
+
+    #[test]
+    fn test_external_sort_spill() {
+        use crate::extsort::ExternalSorter;
+        use crate::models::ComparisonResult;
+
+        // A budget this small forces a spill on nearly every push, so the
+        // merge has to reassemble order across many runs.
+        let mut sorter = ExternalSorter::new(1);
+        for i in (0..200).rev() {
+            sorter
+                .push(ComparisonResult::missing(std::path::PathBuf::from(
+                    format!("f{:03}.txt", i),
+                )))
+                .unwrap();
+        }
+        assert_eq!(sorter.len(), 200);
+
+        let merged: Vec<_> = sorter
+            .into_sorted_iter()
+            .unwrap()
+            .collect::<anyhow::Result<Vec<_>>>()
+            .unwrap();
+        assert_eq!(merged.len(), 200);
+        assert!(merged.windows(2).all(|w| w[0].file < w[1].file));
+        assert_eq!(merged[0].file, std::path::PathBuf::from("f000.txt"));
+    }
+
+    #[test]
+    fn test_compare_with_memory_limit() {
+        use crate::compare::{CompareConfig, run_compare};
+        use crate::models::{Engine, Mode};
+
+        let dir = tempdir().unwrap();
+        let f1 = dir.path().join("a");
+        let f2 = dir.path().join("b");
+        fs::create_dir(&f1).unwrap();
+        fs::create_dir(&f2).unwrap();
+        for i in 0..20 {
+            fs::write(f1.join(format!("f{}.txt", i)), format!("body {}", i)).unwrap();
+            fs::write(f2.join(format!("f{}.txt", i)), format!("body {}", i)).unwrap();
+        }
+        fs::write(f2.join("f3.txt"), "changed").unwrap();
+        fs::write(f1.join("only1.txt"), "x").unwrap();
+
+        let status = run_compare(CompareConfig {
+            folder1: f1,
+            folder2: f2,
+            mode: Mode::Batch,
+            algo: HashAlgo::Blake3,
+            output_folder: None,
+            output_format: OutputFormat::Txt,
+            depth: None,
+            no_recursive: false,
+            symlinks: SymlinkMode::Ignore,
+            verbose: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            threads: None,
+            no_sort: false,
+            diff_cmd: None,
+            cache: false,
+            cache_dir: None,
+            engine: Engine::Classic,
+            hash_sample: None,
+            fail_fast: false,
+            // One byte: every result spills, exercising the merge path.
+            memory_limit: Some(1),
+        })
+        .unwrap();
+        assert_eq!(status, ExitStatus::Diff);
+    }
+
+    #[test]
+    fn test_sha256_tree_hash() {
+        use crate::utils::{compute_hashes, set_par_hash_threshold};
+
+        let dir = tempdir().unwrap();
+        let path = dir.path().join("big.bin");
+        // Two full 16 MiB chunks plus a 1 MiB tail.
+        let mut data = vec![0u8; 33 << 20];
+        for (i, b) in data.iter_mut().enumerate() {
+            *b = (i % 251) as u8;
+        }
+        fs::write(&path, &data).unwrap();
+
+        let sequential = compute_hashes(&path, HashAlgo::Sha256Tree).unwrap();
+        // Forcing the parallel leaf path must not change the digest: the
+        // chunking, not the scheduling, defines the tree hash.
+        set_par_hash_threshold(1 << 20);
+        let parallel = compute_hashes(&path, HashAlgo::Sha256Tree).unwrap();
+        set_par_hash_threshold(128 << 20);
+        assert_eq!(sequential.sha256, parallel.sha256);
+        assert!(sequential.sha256.is_some());
+
+        // Tree digests are a different function from plain sha256.
+        let plain = compute_hashes(&path, HashAlgo::Sha256).unwrap();
+        assert_ne!(sequential.sha256, plain.sha256);
+    }
+
+    #[test]
+    fn test_agent_manifest_join() {
+        use crate::agent::{AgentConfig, join_manifest_for_tests, manifest_for_tests};
+        use crate::models::Status;
+        use crate::utils::{collect_files, compute_hashes};
+        use std::collections::HashMap;
+
+        let dir = tempdir().unwrap();
+        let remote = dir.path().join("remote");
+        let local = dir.path().join("local");
+        fs::create_dir(&remote).unwrap();
+        fs::create_dir(&local).unwrap();
+        fs::write(remote.join("same.txt"), "agreed").unwrap();
+        fs::write(local.join("same.txt"), "agreed").unwrap();
+        fs::write(remote.join("diff.txt"), "remote version").unwrap();
+        fs::write(local.join("diff.txt"), "local version!").unwrap();
+        fs::write(remote.join("extra.txt"), "remote only").unwrap();
+        fs::write(local.join("missing.txt"), "local only").unwrap();
+
+        let manifest = manifest_for_tests(&AgentConfig {
+            folder: remote,
+            algo: HashAlgo::Blake3,
+            depth: None,
+            no_recursive: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            symlinks: SymlinkMode::Ignore,
+            threads: None,
+        })
+        .unwrap();
+
+        let (files, errors) = collect_files(
+            &local,
+            None,
+            false,
+            false,
+            &None,
+            &None,
+            SymlinkMode::Ignore,
+        )
+        .unwrap();
+        assert!(errors.is_empty());
+        let mut local_map: HashMap<_, _> = files
+            .iter()
+            .map(|f| {
+                let h = compute_hashes(&f.path, HashAlgo::Blake3).unwrap();
+                (
+                    f.path.strip_prefix(&local).unwrap().to_path_buf(),
+                    (
+                        f.size,
+                        h.primary_digest(HashAlgo::Blake3).map(str::to_string),
+                    ),
+                )
+            })
+            .collect();
+
+        let (results, remote_errors) =
+            join_manifest_for_tests(&mut local_map, &manifest).unwrap();
+        assert_eq!(remote_errors, 0);
+        let status_of = |name: &str| {
+            results
+                .iter()
+                .find(|(f, _)| f == std::path::Path::new(name))
+                .map(|(_, s)| *s)
+        };
+        assert_eq!(status_of("same.txt"), Some(Status::Match));
+        assert_eq!(status_of("diff.txt"), Some(Status::Diff));
+        assert_eq!(status_of("extra.txt"), Some(Status::Extra));
+        assert_eq!(status_of("missing.txt"), Some(Status::Missing));
+    }
+
+    #[test]
+    fn test_multiway_compare() {
+        use crate::multiway::{MultiwayConfig, run_multiway};
+
+        let dir = tempdir().unwrap();
+        let replicas: Vec<std::path::PathBuf> =
+            (1..=3).map(|i| dir.path().join(format!("r{}", i))).collect();
+        for r in &replicas {
+            fs::create_dir(r).unwrap();
+            fs::write(r.join("same.txt"), "identical everywhere").unwrap();
+        }
+
+        let config = |folders: Vec<std::path::PathBuf>| MultiwayConfig {
+            folders,
+            algo: HashAlgo::Blake3,
+            output_folder: None,
+            output_format: OutputFormat::Txt,
+            depth: None,
+            no_recursive: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            symlinks: SymlinkMode::Ignore,
+            threads: None,
+            hash_sample: None,
+        };
+
+        // All three replicas agree.
+        assert_eq!(
+            run_multiway(config(replicas.clone())).unwrap(),
+            ExitStatus::Success
+        );
+
+        // One replica diverges on content, another is missing a path.
+        fs::write(replicas[1].join("same.txt"), "corrupted on replica2").unwrap();
+        fs::write(replicas[0].join("extra.txt"), "only on r1 and r3").unwrap();
+        fs::write(replicas[2].join("extra.txt"), "only on r1 and r3").unwrap();
+        assert_eq!(
+            run_multiway(config(replicas)).unwrap(),
+            ExitStatus::Diff
+        );
+    }
+
+    #[test]
+    fn test_fail_fast_compare() {
+        use crate::compare::{CompareConfig, run_compare};
+        use crate::models::{Engine, Mode};
+
+        let dir = tempdir().unwrap();
+        let f1 = dir.path().join("a");
+        let f2 = dir.path().join("b");
+        fs::create_dir(&f1).unwrap();
+        fs::create_dir(&f2).unwrap();
+        fs::write(f1.join("x.txt"), "same").unwrap();
+        fs::write(f2.join("x.txt"), "same").unwrap();
+
+        let config = |folder2: std::path::PathBuf| CompareConfig {
+            folder1: f1.clone(),
+            folder2,
+            mode: Mode::Batch,
+            algo: HashAlgo::Blake3,
+            output_folder: None,
+            output_format: OutputFormat::Txt,
+            depth: None,
+            no_recursive: false,
+            symlinks: SymlinkMode::Ignore,
+            verbose: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            threads: None,
+            no_sort: false,
+            diff_cmd: None,
+            cache: false,
+            cache_dir: None,
+            engine: Engine::Classic,
+            hash_sample: None,
+            fail_fast: true,
+            memory_limit: None,
+        };
+
+        // Identical trees still succeed under fail-fast.
+        assert_eq!(run_compare(config(f2.clone())).unwrap(), ExitStatus::Success);
+
+        // A single differing file flips the verdict.
+        fs::write(f2.join("x.txt"), "diff").unwrap();
+        assert_eq!(run_compare(config(f2.clone())).unwrap(), ExitStatus::Diff);
+
+        // So does an extra file on one side.
+        fs::write(f2.join("x.txt"), "same").unwrap();
+        fs::write(f2.join("y.txt"), "extra").unwrap();
+        assert_eq!(run_compare(config(f2)).unwrap(), ExitStatus::Diff);
+    }
+
+    #[test]
+    fn test_path_arena_interning() {
+        use crate::models::PathArena;
+        use std::path::Path;
+
+        let mut arena = PathArena::new();
+        let a = arena.intern(Path::new("dir/file.txt"));
+        let b = arena.intern(Path::new("dir/other.txt"));
+        // Interning the same path again (e.g. from the second folder's walk)
+        // must resolve to the existing id, not a second copy.
+        let a2 = arena.intern(Path::new("dir/file.txt"));
+
+        assert_eq!(a, a2);
+        assert_ne!(a, b);
+        assert_eq!(arena.len(), 2);
+        assert_eq!(arena.get(a), Path::new("dir/file.txt"));
+        assert_eq!(arena.to_path_buf(b), Path::new("dir/other.txt").to_path_buf());
+    }
+
+    #[test]
+    fn test_ndjson_report() {
+        use crate::models::ComparisonResult;
+        use crate::report::{SummaryData, write_ndjson_report};
+        use std::time::Duration;
+
+        let results = vec![
+            ComparisonResult::missing("gone.txt".into()),
+            ComparisonResult::extra("new.txt".into()),
+        ];
+        let summary = SummaryData {
+            total: 2,
+            matches: 0,
+            diffs: 0,
+            missing: 1,
+            extra: 1,
+            errors: 0,
+            elapsed: Duration::from_millis(5),
+        };
+        let mut buf: Vec<u8> = Vec::new();
+        write_ndjson_report(&mut buf, &results, &[], &[], &summary).unwrap();
+
+        // Every line must parse as a standalone JSON object, results first
+        // and the summary record last.
+        let text = String::from_utf8(buf).unwrap();
+        let lines: Vec<&str> = text.lines().collect();
+        assert_eq!(lines.len(), 3);
+        for line in &lines {
+            serde_json::from_str::<serde_json::Value>(line).unwrap();
+        }
+        assert!(lines[0].contains("\"MISSING\""));
+        assert!(lines[2].starts_with("{\"summary\""));
+    }
+
+    #[test]
+    fn test_watch_state_recheck() {
+        use crate::compare::CompareConfig;
+        use crate::models::{Engine, Mode, Status};
+        use crate::watch::WatchState;
+        use std::path::Path;
+
+        let dir = tempdir().unwrap();
+        let f1 = dir.path().join("a");
+        let f2 = dir.path().join("b");
+        fs::create_dir(&f1).unwrap();
+        fs::create_dir(&f2).unwrap();
+        fs::write(f1.join("same.txt"), "same").unwrap();
+        fs::write(f2.join("same.txt"), "same").unwrap();
+        fs::write(f1.join("only1.txt"), "one").unwrap();
+
+        let config = CompareConfig {
+            folder1: f1.clone(),
+            folder2: f2.clone(),
+            mode: Mode::Batch,
+            algo: HashAlgo::Blake3,
+            output_folder: None,
+            output_format: OutputFormat::Txt,
+            depth: None,
+            no_recursive: false,
+            symlinks: SymlinkMode::Ignore,
+            verbose: false,
+            hidden: false,
+            types: None,
+            ignore: None,
+            threads: None,
+            no_sort: false,
+            diff_cmd: None,
+            cache: false,
+            cache_dir: None,
+            engine: Engine::Classic,
+            hash_sample: None,
+            fail_fast: false,
+            memory_limit: None,
+        };
+
+        let mut state = WatchState::initial(&config).unwrap();
+        assert_eq!(state.status_of(Path::new("same.txt")), Some(Status::Match));
+        assert_eq!(
+            state.status_of(Path::new("only1.txt")),
+            Some(Status::Missing)
+        );
+
+        // Diverge one side and re-check only that path, as an event would.
+        fs::write(f2.join("same.txt"), "diff").unwrap();
+        state.recheck(Path::new("same.txt"), &config);
+        assert_eq!(state.status_of(Path::new("same.txt")), Some(Status::Diff));
+
+        // The missing file appears on the other side with equal content.
+        fs::write(f2.join("only1.txt"), "one").unwrap();
+        state.recheck(Path::new("only1.txt"), &config);
+        assert_eq!(state.status_of(Path::new("only1.txt")), Some(Status::Match));
+
+        // Deleting both sides drops the entry entirely.
+        fs::remove_file(f1.join("only1.txt")).unwrap();
+        fs::remove_file(f2.join("only1.txt")).unwrap();
+        state.recheck(Path::new("only1.txt"), &config);
+        assert_eq!(state.status_of(Path::new("only1.txt")), None);
+    }
+
+    #[test]
+    fn test_batched_progress_flush() {
+        use crate::utils::BatchedProgress;
+
+        let pb = indicatif::ProgressBar::new(100);
+        pb.set_draw_target(indicatif::ProgressDrawTarget::hidden());
+        let progress = BatchedProgress::new(Some(pb.clone()), 10);
+
+        // Deltas below the threshold stay in the thread-local counter.
+        progress.add(4);
+        assert_eq!(pb.position(), 0);
+
+        // Crossing the threshold flushes the accumulated total at once.
+        progress.add(7);
+        assert_eq!(pb.position(), 11);
+
+        // finish snaps to the full length, so the residual unflushed
+        // count never shows as missing work.
+        progress.add(3);
+        progress.finish("done");
+        assert_eq!(pb.position(), 100);
+    }
 }
@@ -10,14 +10,133 @@ use std::io;
 use std::path::{Path, PathBuf};
 use std::sync::mpsc;
 
-use crate::models::{ErrorEntry, FileEntry, HashAlgo, HashResult, SymlinkMode};
+use crate::models::{CopyMode, ErrorEntry, FileEntry, HashAlgo, HashResult, SymlinkMode};
+
+const MMAP_THRESHOLD: u64 = 32 * 1024;
+const RAYON_THRESHOLD: u64 = 128 * 1024 * 1024;
+
+/// Chunk size for the SHA-256 tree hash. Part of the digest definition —
+/// changing it changes every tree digest ever written to a snapshot — so
+/// it is a constant, never a tunable.
+const SHA256_TREE_CHUNK: usize = 16 * 1024 * 1024;
+
+/// Minimum file size before a single file is hashed on multiple cores
+/// (BLAKE3's rayon path and the SHA-256 tree leaves). Below it the
+/// per-task overhead outweighs the parallelism; the default matches the
+/// old hard-coded RAYON_THRESHOLD and --par-hash-threshold overrides it
+/// for unusual storage (raise it on cold HDDs, lower it on fast NVMe).
+static PAR_HASH_THRESHOLD: std::sync::atomic::AtomicU64 =
+    std::sync::atomic::AtomicU64::new(RAYON_THRESHOLD);
+
+pub fn set_par_hash_threshold(bytes: u64) {
+    PAR_HASH_THRESHOLD.store(bytes, std::sync::atomic::Ordering::Relaxed);
+}
+
+fn par_hash_threshold() -> u64 {
+    PAR_HASH_THRESHOLD.load(std::sync::atomic::Ordering::Relaxed)
+}
+
+/// When set, every hashed file's pages are advised DONTNEED once its
+/// digest is done, so multi-terabyte verification runs do not evict the
+/// rest of the host's page cache. Process-wide like the stats switch:
+/// the hot hashing path pays one relaxed load instead of every caller
+/// threading a flag through the configs.
+static DROP_CACHE: std::sync::atomic::AtomicBool = std::sync::atomic::AtomicBool::new(false);
+
+pub fn set_drop_cache(enabled: bool) {
+    DROP_CACHE.store(enabled, std::sync::atomic::Ordering::Relaxed);
+}
+
+fn drop_cache_enabled() -> bool {
+    DROP_CACHE.load(std::sync::atomic::Ordering::Relaxed)
+}
+
+/// Tell the kernel the mapping will be read front to back so readahead
+/// runs ahead of the hashing cursor; on cold spinning storage demand
+/// faulting otherwise degenerates into small random-ish reads. Advice is
+/// best-effort — failure just means default readahead.
+fn advise_sequential(mmap: &Mmap) {
+    #[cfg(unix)]
+    let _ = mmap.advise(memmap2::Advice::Sequential);
+    #[cfg(not(unix))]
+    let _ = mmap;
+}
+
+/// Drop this file's pages from the page cache after hashing (Linux only;
+/// a no-op elsewhere). Dirty pages are unaffected — we only ever read.
+fn advise_dontneed(f: &File) {
+    #[cfg(target_os = "linux")]
+    unsafe {
+        use std::os::fd::AsRawFd;
+        libc::posix_fadvise(f.as_raw_fd(), 0, 0, libc::POSIX_FADV_DONTNEED);
+    }
+    #[cfg(not(target_os = "linux"))]
+    let _ = f;
+}
+
+/// Progress updates batched per worker thread.
+///
+/// `pb.inc(1)` per file means one contended atomic (and a possible redraw)
+/// per hashed file; with millions of tiny files that contention is a
+/// measurable slice of runtime. Each worker instead accumulates deltas in
+/// a thread-local counter and flushes to the shared bar only when the
+/// batch threshold is crossed. `finish` snaps the bar to its full length,
+/// so residual unflushed counts never show as missing work. A `None` bar
+/// (non-terminal stderr or --quiet) costs a single branch per update.
+pub struct BatchedProgress {
+    pb: Option<indicatif::ProgressBar>,
+    id: u64,
+    flush_every: u64,
+}
+
+impl BatchedProgress {
+    pub fn new(pb: Option<indicatif::ProgressBar>, flush_every: u64) -> Self {
+        use std::sync::atomic::{AtomicU64, Ordering};
+        static NEXT_ID: AtomicU64 = AtomicU64::new(1);
+        BatchedProgress {
+            pb,
+            id: NEXT_ID.fetch_add(1, Ordering::Relaxed),
+            flush_every: flush_every.max(1),
+        }
+    }
+
+    pub fn add(&self, delta: u64) {
+        use std::cell::Cell;
+        // Tagged with the owning instance so leftovers from an earlier bar
+        // (watch mode re-compares in the same process) are discarded.
+        thread_local! {
+            static PENDING: Cell<(u64, u64)> = const { Cell::new((0, 0)) };
+        }
+        let Some(pb) = &self.pb else { return };
+        PENDING.with(|p| {
+            let (id, pending) = p.get();
+            let total = if id == self.id { pending + delta } else { delta };
+            if total >= self.flush_every {
+                pb.inc(total);
+                p.set((self.id, 0));
+            } else {
+                p.set((self.id, total));
+            }
+        });
+    }
+
+    pub fn finish(&self, msg: &'static str) {
+        if let Some(pb) = &self.pb {
+            if let Some(len) = pb.length() {
+                pb.set_position(len);
+            }
+            pb.finish_with_message(msg);
+        }
+    }
+}
 
 pub fn compute_hashes(path: &Path, algo: HashAlgo) -> io::Result<HashResult> {
+    if algo == HashAlgo::Sha256Tree {
+        return compute_sha256_tree(path);
+    }
     let metadata = fs::metadata(path)?;
     let len = metadata.len();
-
-    const MMAP_THRESHOLD: u64 = 32 * 1024;
-    const RAYON_THRESHOLD: u64 = 128 * 1024 * 1024;
+    let hash_timer = crate::stats::enabled().then(std::time::Instant::now);
 
     let mut sha256_hasher = if matches!(algo, HashAlgo::Sha256 | HashAlgo::Both) {
         Some(Sha256::new())
@@ -29,44 +148,347 @@ pub fn compute_hashes(path: &Path, algo: HashAlgo) -> io::Result<HashResult> {
     } else {
         None
     };
+    let mut xxh3_hasher = if matches!(algo, HashAlgo::Xxh3) {
+        Some(xxhash_rust::xxh3::Xxh3::new())
+    } else {
+        None
+    };
 
     if len == 0 {
         return Ok(HashResult {
             // Fix #3: pre-allocate a 64-char buffer instead of one String-per-byte
             sha256: sha256_hasher.map(|h| bytes_to_hex(&h.finalize())),
             blake3: blake3_hasher.map(|h| h.finalize().to_hex().to_string()),
+            xxh3: xxh3_hasher.map(|h| format!("{:016x}", h.digest())),
+            sampled: false,
         });
     }
 
     if len < MMAP_THRESHOLD {
-        let data = fs::read(path)?;
+        let f = File::open(path)?;
+        let mut data = Vec::with_capacity(len as usize);
+        io::Read::read_to_end(&mut &f, &mut data)?;
         if let Some(h) = sha256_hasher.as_mut() {
             h.update(&data);
         }
         if let Some(bh) = blake3_hasher.as_mut() {
             bh.update(&data);
         }
+        if let Some(xh) = xxh3_hasher.as_mut() {
+            xh.update(&data);
+        }
+        if drop_cache_enabled() {
+            advise_dontneed(&f);
+        }
     } else {
         let f = File::open(path)?;
         let mmap = unsafe { Mmap::map(&f)? };
+        advise_sequential(&mmap);
 
         if let Some(h) = sha256_hasher.as_mut() {
             h.update(&mmap);
         }
         if let Some(bh) = blake3_hasher.as_mut() {
-            if len > RAYON_THRESHOLD {
+            if len > par_hash_threshold() {
                 bh.update_rayon(&mmap);
             } else {
                 bh.update(&mmap);
             }
         }
+        if let Some(xh) = xxh3_hasher.as_mut() {
+            xh.update(&mmap);
+        }
+        if drop_cache_enabled() {
+            // The kernel skips pages still mapped into page tables, so the
+            // mapping must be gone before the fadvise or it is a no-op.
+            drop(mmap);
+            advise_dontneed(&f);
+        }
+    }
+
+    if let Some(t) = hash_timer {
+        crate::stats::record_hash(len, t.elapsed());
     }
 
     // Fix #3: use pre-allocated hex encoding (64 bytes, no per-byte alloc)
     let sha256 = sha256_hasher.map(|h| bytes_to_hex(&h.finalize()));
     let blake3 = blake3_hasher.map(|h| h.finalize().to_hex().to_string());
+    let xxh3 = xxh3_hasher.map(|h| format!("{:016x}", h.digest()));
+
+    Ok(HashResult {
+        sha256,
+        blake3,
+        xxh3,
+        sampled: false,
+    })
+}
+
+/// Chunked SHA-256 tree hash: SHA-256 each fixed-size chunk, then SHA-256
+/// the concatenated chunk digests. Leaves are independent, so above the
+/// parallel threshold they run on all cores — the SHA-2 answer to
+/// BLAKE3's `update_rayon`. The empty file is the digest of zero leaves.
+fn compute_sha256_tree(path: &Path) -> io::Result<HashResult> {
+    use rayon::prelude::*;
+
+    let len = fs::metadata(path)?.len();
+    let hash_timer = crate::stats::enabled().then(std::time::Instant::now);
+
+    let mut outer = Sha256::new();
+    if len > 0 {
+        let f = File::open(path)?;
+        let mmap = unsafe { Mmap::map(&f)? };
+        advise_sequential(&mmap);
+
+        let leaves: Vec<[u8; 32]> = if len > par_hash_threshold() {
+            mmap.par_chunks(SHA256_TREE_CHUNK)
+                .map(|chunk| Sha256::digest(chunk).into())
+                .collect()
+        } else {
+            mmap.chunks(SHA256_TREE_CHUNK)
+                .map(|chunk| Sha256::digest(chunk).into())
+                .collect()
+        };
+        for leaf in &leaves {
+            outer.update(leaf);
+        }
+
+        if drop_cache_enabled() {
+            // Mapped pages survive POSIX_FADV_DONTNEED; unmap first.
+            drop(mmap);
+            advise_dontneed(&f);
+        }
+    }
+
+    if let Some(t) = hash_timer {
+        crate::stats::record_hash(len, t.elapsed());
+    }
+
+    Ok(HashResult {
+        sha256: Some(bytes_to_hex(&outer.finalize())),
+        blake3: None,
+        xxh3: None,
+        sampled: false,
+    })
+}
+
+/// Block size used by sampled hashing.
+const SAMPLE_BLOCK: u64 = 1024 * 1024;
+
+/// Hash only the first block, the last block and `k` evenly spaced interior
+/// blocks (1 MiB each), plus the file length. Catches gross corruption —
+/// truncation, wholesale replacement — in multi-gigabyte media masters at a
+/// tiny fraction of the read cost of a full hash. The result is flagged
+/// `sampled` so it can never be mistaken for (or compared against) a full
+/// digest; sampled digests are also never stored in the persistent cache.
+pub fn compute_hashes_sampled(path: &Path, algo: HashAlgo, k: usize) -> io::Result<HashResult> {
+    let len = fs::metadata(path)?.len();
+
+    // Small enough that the samples would cover the whole file anyway.
+    if len <= (k as u64 + 2) * SAMPLE_BLOCK {
+        let mut h = compute_hashes(path, algo)?;
+        h.sampled = true;
+        return Ok(h);
+    }
+
+    let f = File::open(path)?;
+    let mmap = unsafe { Mmap::map(&f)? };
+    // Scattered 1 MiB blocks, not a front-to-back scan: sequential
+    // readahead would just pull in bytes we never touch.
+    #[cfg(unix)]
+    let _ = mmap.advise(memmap2::Advice::Random);
+
+    // Sampled digests only ever meet other sampled digests, so the tree
+    // variant can degrade to a plain rolling SHA-256 over the samples.
+    let mut sha256_hasher =
+        if matches!(algo, HashAlgo::Sha256 | HashAlgo::Both | HashAlgo::Sha256Tree) {
+            Some(Sha256::new())
+        } else {
+            None
+        };
+    let mut blake3_hasher = if matches!(algo, HashAlgo::Blake3 | HashAlgo::Both) {
+        Some(blake3::Hasher::new())
+    } else {
+        None
+    };
+    let mut xxh3_hasher = if matches!(algo, HashAlgo::Xxh3) {
+        Some(xxhash_rust::xxh3::Xxh3::new())
+    } else {
+        None
+    };
+
+    let mut feed = |data: &[u8]| {
+        if let Some(h) = sha256_hasher.as_mut() {
+            h.update(data);
+        }
+        if let Some(bh) = blake3_hasher.as_mut() {
+            bh.update(data);
+        }
+        if let Some(xh) = xxh3_hasher.as_mut() {
+            xh.update(data);
+        }
+    };
+
+    // The length participates in the digest so two files that happen to agree
+    // on every sampled block but differ in size still hash differently.
+    feed(&len.to_le_bytes());
+
+    // First block, k interior blocks at evenly spaced offsets, last block.
+    let interior_span = len - 2 * SAMPLE_BLOCK;
+    feed(&mmap[..SAMPLE_BLOCK as usize]);
+    for i in 0..k {
+        let off = SAMPLE_BLOCK + interior_span * (i as u64 + 1) / (k as u64 + 1);
+        let off = off.min(len - SAMPLE_BLOCK) as usize;
+        feed(&mmap[off..off + SAMPLE_BLOCK as usize]);
+    }
+    feed(&mmap[(len - SAMPLE_BLOCK) as usize..]);
+
+    if drop_cache_enabled() {
+        // Mapped pages survive POSIX_FADV_DONTNEED; unmap first.
+        drop(mmap);
+        advise_dontneed(&f);
+    }
+
+    Ok(HashResult {
+        sha256: sha256_hasher.map(|h| bytes_to_hex(&h.finalize())),
+        blake3: blake3_hasher.map(|h| h.finalize().to_hex().to_string()),
+        xxh3: xxh3_hasher.map(|h| format!("{:016x}", h.digest())),
+        sampled: true,
+    })
+}
+
+/// Compare two same-size files byte-for-byte, returning false at the first
+/// differing block without reading the rest. The 1 MiB block granularity
+/// keeps the inner loop on `slice ==` (memcmp) while letting diverging
+/// append-only logs bail out after a single read. No hash arithmetic at all.
+pub fn compare_bytes(path1: &Path, path2: &Path) -> io::Result<bool> {
+    const BLOCK: usize = 1024 * 1024;
+
+    let len1 = fs::metadata(path1)?.len();
+    let len2 = fs::metadata(path2)?.len();
+    if len1 != len2 {
+        return Ok(false);
+    }
+    if len1 == 0 {
+        return Ok(true);
+    }
+
+    if len1 < MMAP_THRESHOLD {
+        return Ok(fs::read(path1)? == fs::read(path2)?);
+    }
+
+    let f1 = File::open(path1)?;
+    let f2 = File::open(path2)?;
+    let mmap1 = unsafe { Mmap::map(&f1)? };
+    let mmap2 = unsafe { Mmap::map(&f2)? };
+
+    for (block1, block2) in mmap1.chunks(BLOCK).zip(mmap2.chunks(BLOCK)) {
+        if block1 != block2 {
+            return Ok(false);
+        }
+    }
+    Ok(true)
+}
+
+/// Copy `source` to `dest` honouring the selected [`CopyMode`].
+///
+/// On Linux, Auto first asks the filesystem for a reflink clone (FICLONE) —
+/// on CoW filesystems like Btrfs/XFS that turns a multi-gigabyte copy into a
+/// metadata operation — then falls back to in-kernel copy_file_range, then to
+/// a plain `fs::copy`. Elsewhere (and in Standard mode) it is just `fs::copy`.
+pub fn copy_file(source: &Path, dest: &Path, mode: CopyMode) -> io::Result<u64> {
+    match mode {
+        CopyMode::Standard => fs::copy(source, dest),
+        CopyMode::Reflink => reflink_or(source, dest, |_, _, _| {
+            Err(io::Error::new(
+                io::ErrorKind::Unsupported,
+                "reflink not supported between these paths (use --copy-mode auto to fall back)",
+            ))
+        }),
+        CopyMode::Auto => reflink_or(source, dest, |src, dst, len| {
+            copy_file_range_loop(src, dst, len).or_else(|_| fs::copy(source, dest))
+        }),
+    }
+}
+
+/// Attempt a reflink clone; delegate to `fallback` when the filesystem
+/// refuses (EOPNOTSUPP, EXDEV, non-Linux, ...).
+#[cfg(target_os = "linux")]
+fn reflink_or(
+    source: &Path,
+    dest: &Path,
+    fallback: impl FnOnce(&File, &File, u64) -> io::Result<u64>,
+) -> io::Result<u64> {
+    use std::os::fd::AsRawFd;
+
+    let src = File::open(source)?;
+    let len = src.metadata()?.len();
+    let dst = File::create(dest)?;
+
+    let ret = unsafe { libc::ioctl(dst.as_raw_fd(), libc::FICLONE, src.as_raw_fd()) };
+    let copied = if ret == 0 {
+        len
+    } else {
+        fallback(&src, &dst, len)?
+    };
+
+    // fs::copy preserves permissions; the fd-based paths must do it by hand.
+    dst.set_permissions(src.metadata()?.permissions())?;
+    Ok(copied)
+}
+
+/// No FICLONE here: go straight to the fallback, so strict Reflink mode
+/// still fails with Unsupported instead of silently degrading to a copy.
+#[cfg(not(target_os = "linux"))]
+fn reflink_or(
+    source: &Path,
+    dest: &Path,
+    fallback: impl FnOnce(&File, &File, u64) -> io::Result<u64>,
+) -> io::Result<u64> {
+    let src = File::open(source)?;
+    let len = src.metadata()?.len();
+    let dst = File::create(dest)?;
+
+    let copied = fallback(&src, &dst, len)?;
+
+    // fs::copy preserves permissions; the fd-based paths must do it by hand.
+    dst.set_permissions(src.metadata()?.permissions())?;
+    Ok(copied)
+}
+
+/// Drive copy_file_range until `len` bytes moved; the kernel copies (or on
+/// some filesystems clones) the range without the data crossing userspace.
+#[cfg(target_os = "linux")]
+fn copy_file_range_loop(src: &File, dst: &File, len: u64) -> io::Result<u64> {
+    use std::os::fd::AsRawFd;
+
+    let mut copied: u64 = 0;
+    while copied < len {
+        let chunk = (len - copied).min(1 << 30) as usize;
+        let ret = unsafe {
+            libc::copy_file_range(
+                src.as_raw_fd(),
+                std::ptr::null_mut(),
+                dst.as_raw_fd(),
+                std::ptr::null_mut(),
+                chunk,
+                0,
+            )
+        };
+        match ret {
+            r if r < 0 => return Err(io::Error::last_os_error()),
+            0 => break, // source truncated underneath us
+            r => copied += r as u64,
+        }
+    }
+    Ok(copied)
+}
 
-    Ok(HashResult { sha256, blake3 })
+#[cfg(not(target_os = "linux"))]
+fn copy_file_range_loop(_src: &File, _dst: &File, _len: u64) -> io::Result<u64> {
+    Err(io::Error::new(
+        io::ErrorKind::Unsupported,
+        "copy_file_range is Linux-only",
+    ))
 }
 
 /// Encode a byte slice to lowercase hex with a single pre-allocated String.
@@ -81,6 +503,11 @@ fn bytes_to_hex(bytes: &[u8]) -> String {
     s
 }
 
+/// Capacity of the bounded walker→consumer channel. Large enough to keep the
+/// hashing stage fed, small enough that a stalled consumer applies
+/// backpressure to the walk instead of buffering the whole tree.
+pub const WALK_CHANNEL_CAP: usize = 4096;
+
 pub fn collect_files(
     dir: &Path,
     depth: Option<usize>,
@@ -90,6 +517,101 @@ pub fn collect_files(
     ignore_patterns: &Option<Vec<String>>,
     symlink_mode: SymlinkMode,
 ) -> Result<(Vec<FileEntry>, Vec<ErrorEntry>)> {
+    let (tx, rx) = mpsc::sync_channel(WALK_CHANNEL_CAP);
+    let (tx_err, rx_err) = mpsc::channel();
+
+    stream_files(
+        dir,
+        depth,
+        no_recursive,
+        hidden,
+        types,
+        ignore_patterns,
+        symlink_mode,
+        tx,
+        tx_err,
+    )?;
+
+    let final_files: Vec<FileEntry> = rx.into_iter().collect();
+    let final_errors: Vec<ErrorEntry> = rx_err.into_iter().collect();
+    Ok((final_files, final_errors))
+}
+
+/// Start the parallel directory walk in the background, sending each
+/// `FileEntry` into `tx` as soon as it is discovered. The bounded sender
+/// provides backpressure; both channels close when the walk finishes.
+/// `collect_files` is a thin wrapper that drains the channel into a Vec.
+#[allow(clippy::too_many_arguments)]
+pub fn stream_files(
+    dir: &Path,
+    depth: Option<usize>,
+    no_recursive: bool,
+    hidden: bool,
+    types: &Option<Vec<String>>,
+    ignore_patterns: &Option<Vec<String>>,
+    symlink_mode: SymlinkMode,
+    tx: mpsc::SyncSender<FileEntry>,
+    tx_err: mpsc::Sender<ErrorEntry>,
+) -> Result<()> {
+    let walk_builder = build_walker(dir, depth, no_recursive, hidden, symlink_mode);
+    let custom_ignore_set = build_ignore_set(ignore_patterns)?;
+    let type_filter = build_type_filter(types);
+
+    let walker = walk_builder.build_parallel();
+
+    std::thread::spawn(move || {
+        let walk_timer = crate::stats::enabled().then(std::time::Instant::now);
+        let sent = std::sync::Arc::new(std::sync::atomic::AtomicU64::new(0));
+
+        walker.run(|| {
+            let tx = tx.clone();
+            let tx_err = tx_err.clone();
+            let type_filter = type_filter.clone();
+            let custom_ignore_set = custom_ignore_set.clone();
+            let sent = sent.clone();
+
+            Box::new(move |result| {
+                let entry = match result {
+                    Ok(e) => e,
+                    Err(err) => {
+                        let _ = tx_err.send(ErrorEntry {
+                            path: PathBuf::from("?"),
+                            error: err.to_string(),
+                        });
+                        return ignore::WalkState::Continue;
+                    }
+                };
+
+                if let Some(file_entry) =
+                    filter_entry(&entry, &type_filter, &custom_ignore_set, symlink_mode)
+                {
+                    let _ = tx.send(file_entry);
+                    sent.fetch_add(1, std::sync::atomic::Ordering::Relaxed);
+                }
+
+                ignore::WalkState::Continue
+            })
+        });
+
+        if let Some(t) = walk_timer {
+            crate::stats::record_walk(
+                t.elapsed(),
+                sent.load(std::sync::atomic::Ordering::Relaxed),
+            );
+        }
+    });
+
+    Ok(())
+}
+
+/// Shared WalkBuilder setup for all walk flavours (parallel and sorted).
+fn build_walker(
+    dir: &Path,
+    depth: Option<usize>,
+    no_recursive: bool,
+    hidden: bool,
+    symlink_mode: SymlinkMode,
+) -> WalkBuilder {
     let mut walk_builder = WalkBuilder::new(dir);
     walk_builder.hidden(!hidden);
 
@@ -108,104 +630,124 @@ pub fn collect_files(
         }
     }
 
-    let custom_ignore_set = if let Some(patterns) = ignore_patterns {
+    walk_builder
+}
+
+pub(crate) fn build_ignore_set(
+    ignore_patterns: &Option<Vec<String>>,
+) -> Result<Option<globset::GlobSet>> {
+    if let Some(patterns) = ignore_patterns {
         let mut builder = GlobSetBuilder::new();
         for p in patterns {
             builder.add(Glob::new(p)?);
         }
-        Some(builder.build()?)
+        Ok(Some(builder.build()?))
     } else {
-        None
-    };
+        Ok(None)
+    }
+}
 
-    let type_filter: Option<HashSet<String>> = types.as_ref().map(|exts| {
+pub(crate) fn build_type_filter(types: &Option<Vec<String>>) -> Option<HashSet<String>> {
+    types.as_ref().map(|exts| {
         exts.iter()
             .map(|ext| ext.trim_start_matches('.').to_lowercase())
             .collect()
-    });
-
-    let (tx, rx) = mpsc::channel();
-    let (tx_err, rx_err) = mpsc::channel();
+    })
+}
 
-    let walker = walk_builder.build_parallel();
+/// Apply the ignore/type/symlink filters to a walked entry, producing a
+/// `FileEntry` for anything the comparison should see. Returns None for
+/// directories, filtered-out paths and entries whose metadata is unreadable.
+fn filter_entry(
+    entry: &ignore::DirEntry,
+    type_filter: &Option<HashSet<String>>,
+    custom_ignore_set: &Option<globset::GlobSet>,
+    symlink_mode: SymlinkMode,
+) -> Option<FileEntry> {
+    if let Some(set) = custom_ignore_set
+        && set.is_match(entry.path())
+    {
+        return None;
+    }
 
-    std::thread::spawn(move || {
-        walker.run(|| {
-            let tx = tx.clone();
-            let tx_err = tx_err.clone();
-            let type_filter = type_filter.clone();
-            let custom_ignore_set = custom_ignore_set.clone();
+    let ft = entry.file_type()?;
 
-            Box::new(move |result| {
-                let entry = match result {
-                    Ok(e) => e,
-                    Err(err) => {
-                        let _ = tx_err.send(ErrorEntry {
-                            path: PathBuf::from("?"),
-                            error: err.to_string(),
-                        });
-                        return ignore::WalkState::Continue;
-                    }
-                };
+    let is_symlink = ft.is_symlink();
+    let is_file = ft.is_file();
 
-                if let Some(ref set) = custom_ignore_set
-                    && set.is_match(entry.path())
-                {
-                    return ignore::WalkState::Continue;
-                }
+    let should_include = match symlink_mode {
+        SymlinkMode::Ignore => is_file,
+        SymlinkMode::Follow => is_file,
+        SymlinkMode::Compare => is_file || is_symlink,
+    };
 
-                let ft = match entry.file_type() {
-                    Some(ft) => ft,
-                    None => return ignore::WalkState::Continue,
-                };
+    if !should_include {
+        return None;
+    }
 
-                let is_symlink = ft.is_symlink();
-                let is_file = ft.is_file();
+    if let Some(exts) = type_filter
+        && !entry
+            .path()
+            .extension()
+            .and_then(|s| s.to_str())
+            .is_some_and(|s| exts.contains(&s.to_lowercase()))
+    {
+        return None;
+    }
 
-                let should_include = match symlink_mode {
-                    SymlinkMode::Ignore => is_file,
-                    SymlinkMode::Follow => is_file,
-                    SymlinkMode::Compare => is_file || is_symlink,
-                };
+    let mut symlink_target = None;
+    if is_symlink
+        && matches!(symlink_mode, SymlinkMode::Compare)
+        && let Ok(target) = fs::read_link(entry.path())
+    {
+        symlink_target = Some(target.to_string_lossy().to_string());
+    }
 
-                if !should_include {
-                    return ignore::WalkState::Continue;
-                }
+    let meta = entry.metadata().ok()?;
 
-                if let Some(ref exts) = type_filter
-                    && !entry
-                        .path()
-                        .extension()
-                        .and_then(|s| s.to_str())
-                        .is_some_and(|s| exts.contains(&s.to_lowercase()))
-                {
-                    return ignore::WalkState::Continue;
-                }
+    #[cfg(unix)]
+    let file_id = {
+        use std::os::unix::fs::MetadataExt;
+        Some((meta.dev(), meta.ino()))
+    };
+    #[cfg(not(unix))]
+    let file_id = None;
 
-                let mut symlink_target = None;
-                if is_symlink
-                    && matches!(symlink_mode, SymlinkMode::Compare)
-                    && let Ok(target) = fs::read_link(entry.path())
-                {
-                    symlink_target = Some(target.to_string_lossy().to_string());
-                }
+    Some(FileEntry {
+        path: entry.path().to_path_buf(),
+        size: meta.len(),
+        modified: meta.modified().ok(),
+        symlink_target,
+        file_id,
+    })
+}
 
-                if let Ok(meta) = entry.metadata() {
-                    let entry_data = FileEntry {
-                        path: entry.path().to_path_buf(),
-                        size: meta.len(),
-                        modified: meta.modified().ok(),
-                        symlink_target,
-                    };
-                    let _ = tx.send(entry_data);
-                }
+/// Sequential walk that yields entries in a deterministic order: siblings are
+/// visited sorted by file name, so two trees with the same relative layout
+/// produce identical sequences. Component-wise `Path` ordering agrees with
+/// this traversal order, which is what the merge-join engine relies on.
+pub fn walk_sorted(
+    dir: &Path,
+    depth: Option<usize>,
+    no_recursive: bool,
+    hidden: bool,
+    types: &Option<Vec<String>>,
+    ignore_patterns: &Option<Vec<String>>,
+    symlink_mode: SymlinkMode,
+) -> Result<impl Iterator<Item = std::result::Result<FileEntry, ErrorEntry>> + use<>> {
+    let mut walk_builder = build_walker(dir, depth, no_recursive, hidden, symlink_mode);
+    walk_builder.sort_by_file_name(|a, b| a.cmp(b));
 
-                ignore::WalkState::Continue
-            })
-        });
-    });
+    let custom_ignore_set = build_ignore_set(ignore_patterns)?;
+    let type_filter = build_type_filter(types);
 
-    let final_files: Vec<FileEntry> = rx.into_iter().collect();
-    let final_errors: Vec<ErrorEntry> = rx_err.into_iter().collect();
-    Ok((final_files, final_errors))
+    Ok(walk_builder.build().filter_map(move |result| match result {
+        Ok(entry) => {
+            filter_entry(&entry, &type_filter, &custom_ignore_set, symlink_mode).map(Ok)
+        }
+        Err(err) => Some(Err(ErrorEntry {
+            path: PathBuf::from("?"),
+            error: err.to_string(),
+        })),
+    }))
 }
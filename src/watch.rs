@@ -0,0 +1,365 @@
+//! Watch mode: one initial batch comparison, then filesystem events
+//! (inotify/FSEvents/ReadDirectoryChangesW via the notify crate) drive
+//! incremental re-checks of only the paths that changed. The full
+//! Match/Diff/Missing/Extra state is kept in memory and a one-line summary
+//! is reprinted after every event batch, so steady-state I/O is limited to
+//! re-hashing the files that actually changed.
+
+use anyhow::{Context, Result};
+use colored::*;
+use notify::{RecursiveMode, Watcher};
+use rayon::prelude::*;
+use std::collections::{BTreeSet, HashMap, HashSet};
+use std::fs;
+use std::path::{Path, PathBuf};
+use std::sync::mpsc;
+use std::time::Duration;
+
+use crate::compare::{CompareConfig, ExitStatus, compare_files_core};
+use crate::models::{FileEntry, Status, SymlinkMode};
+use crate::report::print_error_entry;
+use crate::utils::{build_ignore_set, build_type_filter, collect_files};
+
+/// Live comparison state plus the filters needed to re-check single paths
+/// with the same semantics the walker applied during the initial scan.
+pub(crate) struct WatchState {
+    results: HashMap<PathBuf, Status>,
+    ignore_set: Option<globset::GlobSet>,
+    type_filter: Option<HashSet<String>>,
+}
+
+impl WatchState {
+    /// Run the initial full comparison and seed the state from it.
+    pub(crate) fn initial(config: &CompareConfig) -> Result<WatchState> {
+        let (files1, errors1) = collect_files(
+            &config.folder1,
+            config.depth,
+            config.no_recursive,
+            config.hidden,
+            &config.types,
+            &config.ignore,
+            config.symlinks,
+        )?;
+        let (files2, errors2) = collect_files(
+            &config.folder2,
+            config.depth,
+            config.no_recursive,
+            config.hidden,
+            &config.types,
+            &config.ignore,
+            config.symlinks,
+        )?;
+        for e in &errors1 {
+            print_error_entry(e, "folder1");
+        }
+        for e in &errors2 {
+            print_error_entry(e, "folder2");
+        }
+
+        let map1: HashMap<PathBuf, FileEntry> = files1
+            .into_iter()
+            .map(|f| {
+                (
+                    f.path.strip_prefix(&config.folder1).unwrap().to_path_buf(),
+                    f,
+                )
+            })
+            .collect();
+        let mut map2: HashMap<PathBuf, FileEntry> = files2
+            .into_iter()
+            .map(|f| {
+                (
+                    f.path.strip_prefix(&config.folder2).unwrap().to_path_buf(),
+                    f,
+                )
+            })
+            .collect();
+
+        let mut results: HashMap<PathBuf, Status> = HashMap::new();
+        let mut common: Vec<(PathBuf, FileEntry, FileEntry)> = Vec::new();
+        for (rel, e1) in map1 {
+            match map2.remove(&rel) {
+                Some(e2) => common.push((rel, e1, e2)),
+                None => {
+                    results.insert(rel, Status::Missing);
+                }
+            }
+        }
+        for rel in map2.into_keys() {
+            results.insert(rel, Status::Extra);
+        }
+
+        let compared: Vec<(PathBuf, Status)> = common
+            .into_par_iter()
+            .map(|(rel, e1, e2)| {
+                let status = compare_files_core(rel.clone(), &e1, &e2, config, None, None)
+                    .map(|r| r.status)
+                    .unwrap_or(Status::Error);
+                (rel, status)
+            })
+            .collect();
+        results.extend(compared);
+
+        Ok(WatchState {
+            results,
+            ignore_set: build_ignore_set(&config.ignore)?,
+            type_filter: build_type_filter(&config.types),
+        })
+    }
+
+    /// Re-check one relative path on both sides and update the state,
+    /// printing a status line when the verdict changed. Directories trigger
+    /// a subtree rescan so renames and deep creates stay consistent.
+    pub(crate) fn recheck(&mut self, rel: &Path, config: &CompareConfig) {
+        let p1 = config.folder1.join(rel);
+        let p2 = config.folder2.join(rel);
+
+        if p1.is_dir() || p2.is_dir() {
+            self.rescan_subtree(rel, config);
+            return;
+        }
+
+        let e1 = self.stat_entry(&p1, config.symlinks);
+        let e2 = self.stat_entry(&p2, config.symlinks);
+
+        let new_status = match (e1, e2) {
+            (None, None) => {
+                if self.results.remove(rel).is_some() {
+                    println!("[{}]  {}", "GONE".normal(), rel.display());
+                }
+                return;
+            }
+            (Some(_), None) => Status::Missing,
+            (None, Some(_)) => Status::Extra,
+            (Some(e1), Some(e2)) => {
+                compare_files_core(rel.to_path_buf(), &e1, &e2, config, None, None)
+                    .map(|r| r.status)
+                    .unwrap_or(Status::Error)
+            }
+        };
+
+        if self.results.insert(rel.to_path_buf(), new_status) != Some(new_status) {
+            print_transition(new_status, rel);
+        }
+    }
+
+    /// Re-walk `rel` on both sides and re-check everything found there plus
+    /// everything the state still remembers under it (covers deletions).
+    fn rescan_subtree(&mut self, rel: &Path, config: &CompareConfig) {
+        let mut rels: BTreeSet<PathBuf> = self
+            .results
+            .keys()
+            .filter(|r| r.starts_with(rel))
+            .cloned()
+            .collect();
+
+        for (root, side) in [(&config.folder1, rel), (&config.folder2, rel)] {
+            let dir = root.join(side);
+            if !dir.is_dir() {
+                continue;
+            }
+            if let Ok((files, _)) = collect_files(
+                &dir,
+                config.depth,
+                config.no_recursive,
+                config.hidden,
+                &config.types,
+                &config.ignore,
+                config.symlinks,
+            ) {
+                for f in files {
+                    if let Ok(sub) = f.path.strip_prefix(root) {
+                        rels.insert(sub.to_path_buf());
+                    }
+                }
+            }
+        }
+
+        for r in rels {
+            // Entries here are files by construction, so this cannot recurse
+            // back into rescan_subtree for the same prefix.
+            self.recheck(&r, config);
+        }
+    }
+
+    /// Mirror of `filter_entry` for a bare path outside a walk: apply the
+    /// ignore/type/symlink filters and build a `FileEntry`, or None if the
+    /// path is absent, a directory, or filtered out.
+    fn stat_entry(&self, path: &Path, symlink_mode: SymlinkMode) -> Option<FileEntry> {
+        if let Some(set) = &self.ignore_set
+            && set.is_match(path)
+        {
+            return None;
+        }
+
+        let meta = fs::symlink_metadata(path).ok()?;
+        let is_symlink = meta.file_type().is_symlink();
+
+        let meta = match symlink_mode {
+            SymlinkMode::Ignore if is_symlink => return None,
+            // Follow through to the target; a dangling link counts as absent.
+            SymlinkMode::Follow if is_symlink => fs::metadata(path).ok()?,
+            _ => meta,
+        };
+        if !(meta.is_file() || (is_symlink && symlink_mode == SymlinkMode::Compare)) {
+            return None;
+        }
+
+        if let Some(exts) = &self.type_filter
+            && !path
+                .extension()
+                .and_then(|s| s.to_str())
+                .is_some_and(|s| exts.contains(&s.to_lowercase()))
+        {
+            return None;
+        }
+
+        let mut symlink_target = None;
+        if is_symlink
+            && symlink_mode == SymlinkMode::Compare
+            && let Ok(target) = fs::read_link(path)
+        {
+            symlink_target = Some(target.to_string_lossy().to_string());
+        }
+
+        #[cfg(unix)]
+        let file_id = {
+            use std::os::unix::fs::MetadataExt;
+            Some((meta.dev(), meta.ino()))
+        };
+        #[cfg(not(unix))]
+        let file_id = None;
+
+        Some(FileEntry {
+            path: path.to_path_buf(),
+            size: meta.len(),
+            modified: meta.modified().ok(),
+            symlink_target,
+            file_id,
+        })
+    }
+
+    #[cfg(test)]
+    pub(crate) fn status_of(&self, rel: &Path) -> Option<Status> {
+        self.results.get(rel).copied()
+    }
+
+    fn print_summary(&self) {
+        let mut counts = [0usize; 4];
+        for s in self.results.values() {
+            match s {
+                Status::Match => counts[0] += 1,
+                Status::Diff => counts[1] += 1,
+                Status::Missing => counts[2] += 1,
+                Status::Extra => counts[3] += 1,
+                _ => (),
+            }
+        }
+        println!(
+            "{} {} match / {} diff / {} missing / {} extra",
+            "WATCH".cyan().bold(),
+            counts[0],
+            counts[1],
+            counts[2],
+            counts[3]
+        );
+    }
+}
+
+fn print_transition(status: Status, rel: &Path) {
+    let label = match status {
+        Status::Match => "MATCH".green(),
+        Status::Diff => "DIFF".red(),
+        Status::Missing | Status::Extra => status.to_string().blue(),
+        _ => status.to_string().normal(),
+    };
+    println!("[{}]  {}", label, rel.display());
+}
+
+/// Initial comparison, then block on filesystem events forever, re-checking
+/// only what changed. `debounce_ms` is the quiet window after an event
+/// before the batch is processed (editors often emit several events per
+/// save). Returns only when the event channel closes or setup fails.
+pub fn run_watch(config: CompareConfig, debounce_ms: u64) -> Result<ExitStatus> {
+    // Event paths arrive absolute; canonicalise the roots once so
+    // strip_prefix works regardless of how the folders were spelled.
+    let root1 = fs::canonicalize(&config.folder1).context("Failed to resolve folder1")?;
+    let root2 = fs::canonicalize(&config.folder2).context("Failed to resolve folder2")?;
+
+    let mut state = WatchState::initial(&config)?;
+    state.print_summary();
+
+    let (tx, rx) = mpsc::channel();
+    let mut watcher = notify::recommended_watcher(move |res| {
+        let _ = tx.send(res);
+    })?;
+    let rec_mode = if config.no_recursive {
+        RecursiveMode::NonRecursive
+    } else {
+        RecursiveMode::Recursive
+    };
+    watcher.watch(&config.folder1, rec_mode)?;
+    watcher.watch(&config.folder2, rec_mode)?;
+
+    println!(
+        "Watching {} and {} (Ctrl-C to stop)...",
+        config.folder1.display(),
+        config.folder2.display()
+    );
+
+    while let Ok(first) = rx.recv() {
+        let mut batch = vec![first];
+        // Debounce: keep draining until the tree has been quiet for the
+        // whole window, then process the batch as a set of unique paths.
+        while let Ok(ev) = rx.recv_timeout(Duration::from_millis(debounce_ms)) {
+            batch.push(ev);
+        }
+
+        let mut rels: BTreeSet<PathBuf> = BTreeSet::new();
+        for ev in batch {
+            let ev = match ev {
+                Ok(ev) => ev,
+                Err(e) => {
+                    eprintln!("[{}] watch error: {}", "ERROR".red(), e);
+                    continue;
+                }
+            };
+            // Re-checking hashes the files we are watching; reacting to the
+            // resulting Access events would loop forever.
+            if matches!(ev.kind, notify::EventKind::Access(_)) {
+                continue;
+            }
+            for path in ev.paths {
+                let rel = path
+                    .strip_prefix(&root1)
+                    .or_else(|_| path.strip_prefix(&root2));
+                if let Ok(rel) = rel
+                    && !rel.as_os_str().is_empty()
+                    && (config.hidden || !is_hidden(rel))
+                {
+                    rels.insert(rel.to_path_buf());
+                }
+            }
+        }
+
+        if rels.is_empty() {
+            continue;
+        }
+        for rel in &rels {
+            state.recheck(rel, &config);
+        }
+        state.print_summary();
+    }
+
+    Ok(ExitStatus::Success)
+}
+
+/// The walker hides dotfiles unless --hidden; apply the same rule to event
+/// paths so watch does not resurrect filtered entries.
+fn is_hidden(rel: &Path) -> bool {
+    rel.components().any(|c| {
+        c.as_os_str()
+            .to_str()
+            .is_some_and(|s| s.starts_with('.') && s != "." && s != "..")
+    })
+}